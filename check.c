@@ -0,0 +1,927 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+
+
+// behavioural checks of the C API, run by make check: edge cases of every entry point on
+// records that carry their input index, so that the order of equal keys can be verified,
+// and whole sorts of each primitive key kind through the vectorised kernels, which make
+// check also builds limited to AVX2 and without SIMD.  Built with LOGSORT_STATS, the
+// counters are checked too.  Prints the failed checks and exits nonzero
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(c) do { if(!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while(0)
+#define LEN(A) (sizeof(A) / sizeof(*A))
+
+static uint64_t rng = 1;
+
+static uint64_t rand64(void) { // xorshift64*
+	rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+	return rng * 2685821657736338717ULL;
+}
+
+// records sort by key and carry their input index
+
+typedef struct { uint32_t key, idx; } rec;
+
+#define LOGSORT_PREFIX rec
+#define VAR rec
+#define CMP(a, b) ((a)->key > (b)->key)
+#define LOGSORT_RADIX(a) ((a)->key)
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_RADIX
+
+#ifdef LOGSORT_STATS
+
+// records counting their own comparisons, to check the counters of logStats.h against
+
+static unsigned long long cnt_calls;
+
+#define LOGSORT_PREFIX cnt
+#define VAR rec
+#define CMP(a, b) (cnt_calls++, (a)->key > (b)->key)
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+
+#endif
+
+// primitive keys: the vectorised kernels and their radix mode
+
+#define LOGSORT_PREFIX i32
+#define VAR int32_t
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_I32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#define LOGSORT_PREFIX u32
+#define VAR uint32_t
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_U32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#define LOGSORT_PREFIX f32
+#define VAR float
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_F32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#define LOGSORT_PREFIX i64
+#define VAR int64_t
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_I64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#define LOGSORT_PREFIX u64
+#define VAR uint64_t
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_U64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#define LOGSORT_PREFIX f64
+#define VAR double
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_F64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_KEY
+
+#include "logString.h"
+#include "logColumns.h"
+
+static const size_t sizes[] = {0, 1, 2, 3, 17, 100, 5000, 100000};
+static const size_t bLens[] = {LOGSORT_AUTO, 1, 9, 16, 512};
+static const uint32_t mods[] = {1, 2, 10, 0}; // 0: keys of 32 bits
+
+static rec *make_recs(size_t n, uint32_t mod) {
+	rec *a = (rec*)malloc((n+1) * sizeof(rec));
+	size_t i;
+	
+	if(!a) { printf("out of memory\n"); exit(1); }
+	
+	for(i = 0; i < n; i++) {
+		a[i].key = (uint32_t)(mod ? rand64() % mod : rand64());
+		a[i].idx = (uint32_t)i;
+	}
+	return a;
+}
+
+static int rec_before(const rec *a, const rec *b) { // in stable sorted order
+	return a->key < b->key || (a->key == b->key && a->idx < b->idx);
+}
+static int rec_cmp(const void *a, const void *b) {
+	return rec_before((const rec*)b, (const rec*)a) - rec_before((const rec*)a, (const rec*)b);
+}
+
+// a[lo, hi) sorted by key with equal keys in input order
+
+static int stable_sorted(const rec *a, size_t lo, size_t hi) {
+	size_t i;
+	
+	for(i = lo+1; i < hi; i++) if(!rec_before(a+i-1, a+i)) return 0;
+	return 1;
+}
+
+// the stable sorted order of a, computed with qsort on (key, index)
+
+static rec *stable_copy(const rec *a, size_t n) {
+	rec *r = (rec*)malloc((n+1) * sizeof(rec));
+	
+	if(!r) { printf("out of memory\n"); exit(1); }
+	
+	memcpy(r, a, n * sizeof(rec));
+	qsort(r, n, sizeof(rec), rec_cmp);
+	return r;
+}
+
+// a holds each input index below n once
+
+static int is_perm(const rec *a, size_t n) {
+	char *seen = (char*)calloc(n+1, 1);
+	size_t i;
+	int ok = 1;
+	
+	for(i = 0; i < n && ok; i++) {
+		ok = a[i].idx < n && !seen[a[i].idx];
+		seen[a[i].idx] = 1;
+	}
+	free(seen);
+	return ok;
+}
+
+////////////////////////
+//                    //
+//  STABLE PARTITION  //
+//                    //
+////////////////////////
+
+static int key_divisible(const rec *a, void *ctx) {
+	return a->key % *(uint32_t*)ctx == 0;
+}
+
+static void check_partition(void) {
+	size_t s, b, m, i;
+	uint32_t d = 3;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s];
+		rec *a = make_recs(n, mods[m]), *buf = bLens[b] ? (rec*)malloc(bLens[b] * sizeof(rec)) : NULL;
+		
+		rec *p = rec_log_stable_partition(a, n, key_divisible, &d, buf, bLens[b]);
+		int ok = p >= a && p <= a+n && is_perm(a, n);
+		
+		for(i = 0; ok && i < n; i++) {
+			ok = (a[i].key % d == 0) == (a+i < p);
+			if(i && a+i != p) ok &= a[i-1].idx < a[i].idx;
+		}
+		CHECK(ok);
+		free(a); free(buf);
+	}
+}
+
+/////////////////
+//             //
+//  SELECTION  //
+//             //
+/////////////////
+
+static int same_recs(const rec *a, const rec *b, size_t n) {
+	size_t i;
+	
+	for(i = 0; i < n; i++) if(a[i].key != b[i].key || a[i].idx != b[i].idx) return 0;
+	return 1;
+}
+
+static void check_select(void) {
+	size_t s, b, m, j, i;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s], ks[] = {0, 1, n/2, n ? n-1 : 0, n};
+		rec *a = make_recs(n, mods[m]), *r = stable_copy(a, n), *c = make_recs(n, 1);
+		
+		for(j = 0; j < LEN(ks); j++) {
+			size_t k = ks[j];
+			int ok;
+			
+			if(k > n) continue;
+			if(k < n) { // a[k] is that of the sorted order, smaller elements before it
+				memcpy(c, a, n * sizeof(rec));
+				rec_logsort_select(c, n, k, bLens[b]);
+				ok = is_perm(c, n) && same_recs(c+k, r+k, 1);
+				
+				for(i = 0; ok && i < n; i++) ok = i == k || (i < k) == rec_before(c+i, c+k);
+				CHECK(ok);
+			}
+			memcpy(c, a, n * sizeof(rec));
+			rec_logsort_partial(c, n, k, bLens[b]);
+			CHECK(is_perm(c, n) && same_recs(c, r, k));
+			
+			memcpy(c, a, n * sizeof(rec));
+			rec_logsort_topk(c, n, k, bLens[b]);
+			CHECK(is_perm(c, n) && same_recs(c+n-k, r+n-k, k));
+		}
+		free(a); free(r); free(c);
+	}
+}
+
+///////////////
+//           //
+//  SORTING  //
+//           //
+///////////////
+
+// inputs with natural runs: ascending, non-increasing with runs of equal keys, sawtooth,
+// organ pipe, and ascending with a few random elements
+
+static rec *make_runs(size_t n, int kind) {
+	rec *a = make_recs(n, 0);
+	size_t i;
+	
+	for(i = 0; i < n; i++) {
+		switch(kind) {
+			case 0:  a[i].key = (uint32_t)i; break;
+			case 1:  a[i].key = (uint32_t)(n - i/3); break;
+			case 2:  a[i].key = (uint32_t)(i % 1000); break;
+			case 3:  a[i].key = (uint32_t)(i < n/2 ? i : n-i); break;
+			default: a[i].key = rand64() % 64 ? (uint32_t)i : (uint32_t)rand64();
+		}
+	}
+	return a;
+}
+
+static void check_sort(void) {
+	size_t s, b, m;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods) + 5; m++) {
+		size_t n = sizes[s];
+		rec *a = m < LEN(mods) ? make_recs(n, mods[m]) : make_runs(n, (int)(m - LEN(mods)));
+		rec *c = make_recs(n, 1), *buf = bLens[b] ? (rec*)malloc(bLens[b] * sizeof(rec)) : NULL;
+		
+		memcpy(c, a, n * sizeof(rec));
+		rec_logsort(c, n, bLens[b]);
+		CHECK(is_perm(c, n) && stable_sorted(c, 0, n));
+		
+		memcpy(c, a, n * sizeof(rec)); // NULL or short buffers use the stack
+		rec_logsort_scratch(c, n, buf, bLens[b]);
+		CHECK(is_perm(c, n) && stable_sorted(c, 0, n));
+		
+		free(a); free(c); free(buf);
+	}
+}
+
+// the merge sort that logsort_rec falls back to after too many unbalanced partitions
+
+static void check_merge_sort(void) {
+	size_t s, b, m;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 1; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s];
+		rec *a = make_recs(n, mods[m]), *buf = (rec*)malloc(bLens[b] * sizeof(rec));
+		
+		rec_log_merge_sort(a, buf, n, bLens[b]);
+		CHECK(is_perm(a, n) && stable_sorted(a, 0, n));
+		free(a); free(buf);
+	}
+}
+
+// the three-way partition around key 100, with each class or none of them the largest, so
+// that its block partition swaps each class into place
+
+static void check_partition_three(void) {
+	static const unsigned weights[][3] = {{1,1,1}, {8,1,1}, {1,8,1}, {1,1,8}, {1,0,1}, {0,1,0}, {2,3,0}};
+	static const size_t lens[] = {9, 16, 64, 512};
+	size_t s, b, w, i;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(lens); b++) for(w = 0; w < LEN(weights); w++) {
+		size_t n = sizes[s], cnt[3] = {0, 0, 0};
+		unsigned t = weights[w][0] + weights[w][1] + weights[w][2];
+		rec *a = make_recs(n, 0), *buf = (rec*)malloc(lens[b] * sizeof(rec)), piv = {100, 0}, *eq;
+		
+		for(i = 0; i < n; i++) {
+			unsigned r = (unsigned)(rand64() % t), c = r < weights[w][0] ? 0 : r < t - weights[w][2] ? 1 : 2;
+			
+			a[i].key = c == 1 ? 100 : (uint32_t)(c*100 + rand64() % 100);
+			cnt[c]++;
+		}
+		rec *p = rec_log_partition_three(a, buf, n, lens[b], &piv, &eq);
+		int ok = is_perm(a, n) && p == a + cnt[0] && eq == p + cnt[1];
+		
+		for(i = 1; ok && i < n; i++) { // classes in order, each in input order
+			unsigned c0 = a[i-1].key < 100 ? 0 : a[i-1].key == 100 ? 1 : 2;
+			unsigned c1 = a[i].key   < 100 ? 0 : a[i].key   == 100 ? 1 : 2;
+			
+			ok = c0 < c1 || (c0 == c1 && a[i-1].idx < a[i].idx);
+		}
+		CHECK(ok);
+		free(a); free(buf);
+	}
+}
+
+///////////////////
+//               //
+//  KEY KERNELS  //
+//               //
+///////////////////
+
+// whole sorts of each primitive key kind, compared bitwise with qsort on (key, index) so
+// that the order of -0.0 and 0.0 counts.  Duplicate-heavy keys take the three-way
+// partition and blocks of 32-bit keys up to 64 long the sorting network
+
+static const size_t keySizes[] = {0, 1, 2, 3, 17, 64, 65, 100, 5000, 100000};
+
+#define KEY_CHECK(NAME, T)                                                                    \
+typedef struct { T v; size_t i; } NAME##_pair;                                                \
+                                                                                              \
+static int NAME##_pair_cmp(const void *a, const void *b) {                                    \
+	const NAME##_pair *x = (const NAME##_pair*)a, *y = (const NAME##_pair*)b;                 \
+	return x->v < y->v ? -1 : y->v < x->v ? 1 : (x->i > y->i) - (x->i < y->i);                \
+}                                                                                             \
+static void check_keys_##NAME(void) {                                                         \
+	size_t s, b, m, i;                                                                        \
+	                                                                                          \
+	for(s = 0; s < LEN(keySizes); s++) for(m = 0; m < LEN(mods); m++) {                       \
+		size_t n = keySizes[s];                                                               \
+		T *a = (T*)malloc((n+1) * sizeof(T)), *c = (T*)malloc((n+1) * sizeof(T));             \
+		T *r = (T*)malloc((n+1) * sizeof(T));                                                 \
+		NAME##_pair *p = (NAME##_pair*)malloc((n+1) * sizeof(NAME##_pair));                   \
+		                                                                                      \
+		if(!a || !c || !r || !p) { printf("out of memory\n"); exit(1); }                      \
+		                                                                                      \
+		for(i = 0; i < n; i++) {                                                              \
+			a[i] = (T)(int64_t)(mods[m] ? rand64() % mods[m] - mods[m]/2 : rand64());         \
+			if(a[i] == 0 && rand64() & 1) a[i] = -a[i];                                       \
+			p[i].v = a[i]; p[i].i = i;                                                        \
+		}                                                                                     \
+		qsort(p, n, sizeof(NAME##_pair), NAME##_pair_cmp);                                    \
+		for(i = 0; i < n; i++) r[i] = p[i].v;                                                 \
+		                                                                                      \
+		for(b = 0; b < LEN(bLens); b++) {                                                     \
+			memcpy(c, a, n * sizeof(T));                                                      \
+			NAME##_logsort(c, n, bLens[b]);                                                   \
+			CHECK(!memcmp(c, r, n * sizeof(T)));                                              \
+		}                                                                                     \
+		free(a); free(c); free(r); free(p);                                                   \
+	}                                                                                         \
+}
+
+KEY_CHECK(i32, int32_t)
+KEY_CHECK(u32, uint32_t)
+KEY_CHECK(f32, float)
+KEY_CHECK(i64, int64_t)
+KEY_CHECK(u64, uint64_t)
+KEY_CHECK(f64, double)
+
+#undef KEY_CHECK
+
+///////////////
+//           //
+//  MERGING  //
+//           //
+///////////////
+
+// a[0, l) and a[l, n) sorted separately are merged, or a[l, n) is appended to a[0, l)
+
+static void check_merge(void) {
+	size_t s, b, m, j;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s], ls[] = {0, 1, n/3, n/2, n ? n-1 : 0, n};
+		rec *a = make_recs(n, mods[m]), *r = stable_copy(a, n), *c = make_recs(n, 1);
+		rec *buf = bLens[b] ? (rec*)malloc(bLens[b] * sizeof(rec)) : NULL;
+		
+		for(j = 0; j < LEN(ls); j++) {
+			size_t l = ls[j];
+			
+			if(l > n) continue;
+			
+			memcpy(c, a, n * sizeof(rec));
+			qsort(c, l, sizeof(rec), rec_cmp);
+			qsort(c+l, n-l, sizeof(rec), rec_cmp);
+			
+			rec_logmerge(c, l, n-l, buf, bLens[b]);
+			CHECK(same_recs(c, r, n));
+			
+			memcpy(c, a, n * sizeof(rec));
+			qsort(c, l, sizeof(rec), rec_cmp);
+			
+			rec_logmerge_append(c, l, n-l, buf, bLens[b]);
+			CHECK(same_recs(c, r, n));
+		}
+		free(a); free(r); free(c); free(buf);
+	}
+}
+
+/////////////////////
+//                 //
+//  RADIX SORTING  //
+//                 //
+/////////////////////
+
+static int i32_cmp(const void *a, const void *b) {
+	int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+	return (x > y) - (x < y);
+}
+
+// records by LOGSORT_RADIX and signed keys by LOGSORT_KEY, including both extremes
+
+static void check_radix(void) {
+	size_t s, b, m, i;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s];
+		rec *a = make_recs(n, mods[m]);
+		int32_t *x = (int32_t*)malloc((n+1) * sizeof(int32_t)), *y = (int32_t*)malloc((n+1) * sizeof(int32_t));
+		
+		if(!x || !y) { printf("out of memory\n"); exit(1); }
+		
+		rec_logsort_radix(a, n, bLens[b]);
+		CHECK(is_perm(a, n) && stable_sorted(a, 0, n));
+		
+		for(i = 0; i < n; i++) {
+			x[i] = (int32_t)(mods[m] ? rand64() % mods[m] - mods[m]/2 : rand64());
+			if(i % 97 == 1) x[i] = i % 2 ? INT32_MIN : INT32_MAX;
+		}
+		memcpy(y, x, n * sizeof(int32_t));
+		qsort(y, n, sizeof(int32_t), i32_cmp);
+		
+		i32_logsort_radix(x, n, bLens[b]);
+		CHECK(!memcmp(x, y, n * sizeof(int32_t)));
+		
+		free(a); free(x); free(y);
+	}
+}
+
+/////////////////////////
+//                     //
+//  SEGMENTED SORTING  //
+//                     //
+/////////////////////////
+
+// cuts n elements into segments of up to maxLen, which may leave a tail outside every
+// segment; maxLen 0 gives a few empty segments and n 0 none.  Returns nseg, off has n+6
+// entries
+
+static size_t make_segments(size_t *off, size_t n, size_t maxLen) {
+	size_t nseg = 0;
+	
+	off[0] = 0;
+	
+	if(!maxLen) {
+		while(nseg < 5) { nseg++; off[nseg] = 0; }
+		return nseg;
+	}
+	while(off[nseg] < n && nseg < n+4) {
+		size_t len = rand64() % (maxLen+1);
+		
+		if(len > n - off[nseg]) len = n - off[nseg];
+		nseg++; off[nseg] = off[nseg-1] + len;
+		
+		if(rand64() % 256 == 0) break; // leave a tail
+	}
+	return nseg;
+}
+
+static void check_segmented(void) {
+	static const size_t maxLens[] = {0, 2, LOG_BATCH_LEN, 40, 5000};
+	size_t s, l, b, m, i;
+	
+	for(s = 0; s < LEN(sizes); s++) for(l = 0; l < LEN(maxLens); l++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s], *off = (size_t*)malloc((n+6) * sizeof(size_t));
+		size_t nseg = make_segments(off, n, maxLens[l]);
+		rec *a = make_recs(n, mods[m]), *c = make_recs(n, 1), *r = make_recs(n, 1);
+		int32_t *x = (int32_t*)malloc((n+1) * sizeof(int32_t)), *y = (int32_t*)malloc((n+1) * sizeof(int32_t));
+		
+		if(!off || !x || !y) { printf("out of memory\n"); exit(1); }
+		
+		memcpy(r, a, n * sizeof(rec));
+		for(i = 0; i < n; i++) x[i] = (int32_t)(a[i].key - (mods[m] ? mods[m]/2 : 0));
+		memcpy(y, x, n * sizeof(int32_t));
+		
+		for(i = 0; i < nseg; i++) {
+			qsort(r + off[i], off[i+1]-off[i], sizeof(rec), rec_cmp);
+			qsort(y + off[i], off[i+1]-off[i], sizeof(int32_t), i32_cmp);
+		}
+		for(b = 0; b < LEN(bLens); b++) {
+			memcpy(c, a, n * sizeof(rec));
+			rec_logsort_segmented(c, off, nseg, bLens[b]);
+			CHECK(!memcmp(c, r, n * sizeof(rec)));
+#ifdef _OPENMP
+			memcpy(c, a, n * sizeof(rec));
+			rec_logsort_segmented_parallel(c, off, nseg, bLens[b]);
+			CHECK(!memcmp(c, r, n * sizeof(rec)));
+#endif
+		}
+		// 32-bit keys sort runs of short segments together
+		
+		i32_logsort_segmented(x, off, nseg, LOGSORT_AUTO);
+		CHECK(!memcmp(x, y, n * sizeof(int32_t)));
+		
+		free(off); free(a); free(c); free(r); free(x); free(y);
+	}
+}
+
+#ifdef _OPENMP
+
+////////////////////////
+//                    //
+//  PARALLEL SORTING  //
+//                    //
+////////////////////////
+
+// more threads than cores still run the parallel partition, which needs 4*MIN_PARALLEL
+// elements per chunk
+
+static void check_parallel(void) {
+	static const size_t pSizes[] = {0, 1, 2, 100, 100000, (size_t)1 << 19};
+	size_t s, b, m;
+	
+	omp_set_num_threads(4);
+	
+	for(s = 0; s < LEN(pSizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = pSizes[s];
+		rec *a = make_recs(n, mods[m]);
+		
+		rec_logsort_parallel(a, n, bLens[b]);
+		CHECK(is_perm(a, n) && stable_sorted(a, 0, n));
+		free(a);
+	}
+}
+
+#endif
+
+//////////////////////
+//                  //
+//  STRING SORTING  //
+//                  //
+//////////////////////
+
+// keys of up to STR_MAX bytes over a small alphabet share long prefixes and repeat often.
+// Each key lives at base + i*STR_STRIDE, so its input index is known after sorting
+
+#define STR_MAX 20
+#define STR_STRIDE 24
+
+static int str_cmp(const void *a, const void *b) { // strcmp, then input order
+	const char *x = *(const char**)a, *y = *(const char**)b;
+	int c = strcmp(x, y);
+	
+	return c ? c : (x > y) - (x < y);
+}
+static int view_cmp(const void *a, const void *b) { // memcmp and length, then input order
+	const log_strview *x = (const log_strview*)a, *y = (const log_strview*)b;
+	int c = log_strview_cmp(x, y);
+	
+	return c ? c : (x->p > y->p) - (x->p < y->p);
+}
+
+static void check_strings(void) {
+	static const char alpha[] = {'a', 'b', '\0', (char)0xFF}; // views also hold NUL and 0xFF
+	size_t s, i, j;
+	
+	for(s = 0; s < LEN(sizes); s++) {
+		size_t n = sizes[s];
+		char *base = (char*)calloc(n+1, STR_STRIDE);
+		const char **a = (const char**)malloc((n+1) * sizeof(char*)), **r = (const char**)malloc((n+1) * sizeof(char*));
+		log_strview *v = (log_strview*)malloc((n+1) * sizeof(log_strview)), *w = (log_strview*)malloc((n+1) * sizeof(log_strview));
+		
+		if(!base || !a || !r || !v || !w) { printf("out of memory\n"); exit(1); }
+		
+		for(i = 0; i < n; i++) {
+			char *p = base + i*STR_STRIDE;
+			size_t len = rand64() % (STR_MAX+1);
+			
+			for(j = 0; j < len; j++) p[j] = alpha[rand64() % (j < 9 ? 1 : 4)];
+			
+			a[i] = p;
+			v[i].p = p; v[i].len = len;
+		}
+		memcpy(r, a, n * sizeof(char*));
+		memcpy(w, v, n * sizeof(log_strview));
+		qsort(r, n, sizeof(char*), str_cmp);
+		qsort(w, n, sizeof(log_strview), view_cmp);
+		
+		logsort_strings(a, n);
+		CHECK(!memcmp(a, r, n * sizeof(char*)));
+		
+		logsort_strviews(v, n);
+		CHECK(!memcmp(v, w, n * sizeof(log_strview)));
+		
+		free(base); free(a); free(r); free(v); free(w);
+	}
+}
+
+////////////////////////
+//                    //
+//  COLUMNAR SORTING  //
+//                    //
+////////////////////////
+
+// tables of two key columns, the row index and a payload too wide to gather, with their
+// input keys.  Each has its own random state, so that threads can build them at once
+
+typedef struct { uint64_t v[5]; } row_pad;
+
+typedef struct {
+	size_t n;
+	uint8_t *k0, *r0;
+	int32_t *k1, *r1;
+	uint32_t *id;
+	row_pad *pad;
+} table;
+
+static int u8_cmp(const void *a, const void *b) { return (*(const uint8_t*)a > *(const uint8_t*)b) - (*(const uint8_t*)a < *(const uint8_t*)b); }
+
+static table make_table(size_t n, uint32_t mod, uint64_t seed) {
+	table t;
+	size_t i, j;
+	
+	t.n = n;
+	t.k0 = (uint8_t*)malloc(n+1); t.r0 = (uint8_t*)malloc(n+1);
+	t.k1 = (int32_t*)malloc((n+1) * sizeof(int32_t)); t.r1 = (int32_t*)malloc((n+1) * sizeof(int32_t));
+	t.id = (uint32_t*)malloc((n+1) * sizeof(uint32_t));
+	t.pad = (row_pad*)malloc((n+1) * sizeof(row_pad));
+	
+	if(!t.k0 || !t.r0 || !t.k1 || !t.r1 || !t.id || !t.pad) { printf("out of memory\n"); exit(1); }
+	
+	for(i = 0; i < n; i++) {
+		seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+		uint64_t r = seed * 2685821657736338717ULL;
+		
+		t.k0[i] = (uint8_t)(r % 3);
+		t.k1[i] = (int32_t)(mod ? (r >> 8) % mod : r >> 8);
+		t.id[i] = (uint32_t)i;
+		for(j = 0; j < 5; j++) t.pad[i].v[j] = i*7 + j;
+	}
+	memcpy(t.r0, t.k0, n); memcpy(t.r1, t.k1, n * sizeof(int32_t));
+	return t;
+}
+static void free_table(table t) {
+	free(t.k0); free(t.r0); free(t.k1); free(t.r1); free(t.id); free(t.pad);
+}
+
+// each row moved whole, once, and the rows in stable order of both keys
+
+static int table_sorted(table t) {
+	char *seen = (char*)calloc(t.n+1, 1);
+	size_t i, r;
+	int ok = 1;
+	
+	for(i = 0; i < t.n && ok; i++) {
+		r = t.id[i];
+		ok = r < t.n && !seen[r] && t.k0[i] == t.r0[r] && t.k1[i] == t.r1[r]
+		  && t.pad[i].v[0] == r*7 && t.pad[i].v[4] == r*7 + 4;
+		if(ok) seen[r] = 1;
+		
+		if(ok && i) {
+			int c = u8_cmp(t.k0+i-1, t.k0+i);
+			if(!c) c = i32_cmp(t.k1+i-1, t.k1+i);
+			ok = c < 0 || (!c && t.id[i-1] < t.id[i]);
+		}
+	}
+	free(seen);
+	return ok;
+}
+
+static int sort_table(table t, int (*cmp0)(const void*, const void*)) {
+	log_column col[] = {
+		{t.id, sizeof(uint32_t), NULL},
+		{t.k0, sizeof(uint8_t), cmp0},
+		{t.pad, sizeof(row_pad), NULL},
+		{t.k1, sizeof(int32_t), i32_cmp}
+	};
+	return logsort_columns(col, LEN(col), t.n);
+}
+
+// a comparator sorting a table of its own first, which must leave the outer sort intact
+
+static int nested_failures;
+
+static int u8_cmp_nested(const void *a, const void *b) {
+	uint8_t k[3] = {2, 0, 1};
+	uint32_t v[3] = {0, 1, 2};
+	log_column col[] = {{v, sizeof(uint32_t), NULL}, {k, sizeof(uint8_t), u8_cmp}};
+	
+	if(logsort_columns(col, LEN(col), 3) || k[0] != 0 || v[0] != 1 || v[2] != 0) nested_failures++;
+	return u8_cmp(a, b);
+}
+
+static void check_columns(void) {
+	size_t s, m;
+	
+	for(s = 0; s < LEN(sizes); s++) {
+		for(m = 0; m < LEN(mods); m++) {
+			table t = make_table(sizes[s], mods[m], rand64() | 1);
+			
+			CHECK(sort_table(t, u8_cmp) == 0 && table_sorted(t));
+			free_table(t);
+			
+			if(sizes[s] > 5000) continue;
+			
+			t = make_table(sizes[s], mods[m], rand64() | 1);
+			nested_failures = 0;
+			CHECK(sort_table(t, u8_cmp_nested) == 0 && table_sorted(t) && !nested_failures);
+			free_table(t);
+		}
+	}
+#ifdef _OPENMP
+	// tables of different shapes sorted on several threads at once
+	
+	int ok = 1;
+	long long i;
+	
+	#pragma omp parallel for num_threads(4) reduction(&&:ok)
+	for(i = 0; i < 16; i++) {
+		table t = make_table(1000 + 997*(size_t)i, mods[i % LEN(mods)], 2*(uint64_t)i + 1);
+		
+		ok = ok && sort_table(t, u8_cmp) == 0 && table_sorted(t);
+		free_table(t);
+	}
+	CHECK(ok);
+#endif
+}
+
+////////////////////////
+//                    //
+//  EXTERNAL SORTING  //
+//                    //
+////////////////////////
+
+// memory for one run, many runs, and merge buffers for a fan in of 2 or many
+
+static void check_file(void) {
+	size_t mems[] = {64 * sizeof(rec), 4096 * sizeof(rec), 1 << 22}, ios[] = {1, 1 << 17, 1 << 22};
+	size_t s, m, i, j;
+	
+	for(s = 0; s < LEN(sizes); s++) for(m = 0; m < LEN(mods); m++) for(i = 0; i < LEN(mems); i++) for(j = 0; j < LEN(ios); j++) {
+		size_t n = sizes[s];
+		rec *a = make_recs(n, mods[m]), *r = stable_copy(a, n), *c = make_recs(n+1, 1);
+		FILE *in = tmpfile(), *out = tmpfile();
+		
+		if(!in || !out) { printf("no temporary files\n"); exit(1); }
+		
+		fwrite(a, sizeof(rec), n, in);
+		rewind(in);
+		
+		CHECK(rec_logsort_file(in, out, mems[i], ios[j]) == 0);
+		
+		rewind(out); // exactly n records come out
+		CHECK(fread(c, sizeof(rec), n+1, out) == n && same_recs(c, r, n));
+		
+		fclose(in); fclose(out);
+		free(a); free(r); free(c);
+	}
+	FILE *in = tmpfile(), *out = tmpfile(); // no memory for runs
+	
+	CHECK(in && out && rec_logsort_file(in, out, 0, 1 << 17) == -1);
+	if(in) fclose(in);
+	if(out) fclose(out);
+}
+
+#ifdef LOGSORT_STATS
+
+///////////////////////
+//                   //
+//  INSTRUMENTATION  //
+//                   //
+///////////////////////
+
+// counters after a reset are zero, the phases and depths each add up to the same totals,
+// the comparisons to those made, and partitions record their larger parts
+
+static int stats_zero(const log_stats *st) {
+	int i, ok = 1;
+	
+	for(i = 0; i < LOG_PHASES; i++) ok &= !st->phase[i].cmp && !st->phase[i].moves && !st->phase[i].bytes;
+	for(i = 0; i < LOG_STATS_DEPTH; i++) {
+		ok &= !st->depth[i].cmp && !st->depth[i].moves && !st->depth[i].bytes;
+		ok &= !st->parts[i] && !st->elems[i] && !st->larger[i];
+	}
+	return ok;
+}
+
+static void check_stats(void) {
+	size_t s, b, m;
+	int i;
+	
+	for(s = 0; s < LEN(sizes); s++) for(b = 0; b < LEN(bLens); b++) for(m = 0; m < LEN(mods); m++) {
+		size_t n = sizes[s];
+		rec *a = make_recs(n, mods[m]);
+		
+		cnt_logsort(a, n, bLens[b]); // leaves the counters dirty for the reset
+		log_stats_reset();
+		CHECK(stats_zero(&log_stats_data) && log_stats_cmps() == 0);
+		
+		free(a);
+		a = make_recs(n, mods[m]);
+		cnt_calls = 0;
+		cnt_logsort(a, n, bLens[b]);
+		CHECK(is_perm(a, n) && stable_sorted(a, 0, n));
+		
+		const log_stats *st = log_stats_get();
+		log_counter p = {0}, d = {0};
+		unsigned long long parts = 0, elems = 0, larger = 0;
+		
+		for(i = 0; i < LOG_PHASES; i++) {
+			p.cmp += st->phase[i].cmp; p.moves += st->phase[i].moves;
+			p.bytes += st->phase[i].bytes; p.ticks += st->phase[i].ticks;
+		}
+		for(i = 0; i < LOG_STATS_DEPTH; i++) {
+			d.cmp += st->depth[i].cmp; d.moves += st->depth[i].moves;
+			d.bytes += st->depth[i].bytes; d.ticks += st->depth[i].ticks;
+			parts += st->parts[i]; elems += st->elems[i]; larger += st->larger[i];
+		}
+		CHECK(log_stats_cmps() == cnt_calls && p.cmp == cnt_calls && d.cmp == cnt_calls);
+		CHECK(p.moves == d.moves && p.bytes == d.bytes && p.ticks == d.ticks);
+		CHECK(larger <= elems); // equal keys may leave both parts small
+		
+		if(n >= 5000 && !mods[m]) // random keys are partitioned, and blocks copied with memcpy
+			CHECK(parts > 0 && p.bytes > 0 && p.moves > 0);
+		
+		free(a);
+	}
+}
+
+#endif
+
+int main(void) {
+	check_partition();
+	check_select();
+	check_sort();
+	check_merge_sort();
+	check_partition_three();
+	check_keys_i32();
+	check_keys_u32();
+	check_keys_f32();
+	check_keys_i64();
+	check_keys_u64();
+	check_keys_f64();
+	check_merge();
+	check_radix();
+	check_segmented();
+#ifdef _OPENMP
+	check_parallel();
+#endif
+	check_file();
+	check_strings();
+	check_columns();
+#ifdef LOGSORT_STATS
+	check_stats();
+#endif
+	
+	printf("check: %d failed\n", failures);
+	return failures != 0;
+}
@@ -0,0 +1,531 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+
+
+// behavioural checks of the C++ front end in logsort.hpp, run by make check: edge cases of
+// the pointer and iterator forms on records that carry their input index, so that the order
+// of equal keys and the payload can be verified, and of the key kernels that std::less
+// selects for primitive types.  Prints the failed checks and exits nonzero
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "logsort.hpp"
+
+static int failures;
+
+#define CHECK(c) do { if(!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while(0)
+
+static uint64_t rng = 1;
+
+static uint64_t rand64() { // xorshift64*
+	rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+	return rng * 2685821657736338717ULL;
+}
+
+// wide records: the key, the input index and a payload derived from it
+
+struct wide {
+	uint32_t key, idx;
+	uint64_t pad[6];
+};
+
+struct by_key {
+	bool operator()(const wide &a, const wide &b) const { return a.key < b.key; }
+};
+
+struct key_prefix {
+	uint32_t operator()(const wide &a) const { return a.key >> 4; }
+};
+
+static const size_t sizes[] = {0, 1, 2, 3, 17, 100, 5000};
+static const size_t bLens[] = {LOGSORT_AUTO, 1, 9, 16, 512};
+static const uint32_t mods[] = {1, 2, 10, 0}; // 0: keys of 32 bits
+
+static std::vector<wide> make_wide(size_t n, uint32_t mod) {
+	std::vector<wide> a(n);
+	
+	for(size_t i = 0; i < n; i++) {
+		a[i].key = (uint32_t)(mod ? rand64() % mod : rand64());
+		a[i].idx = (uint32_t)i;
+		
+		for(size_t j = 0; j < 6; j++) a[i].pad[j] = i*7 + j;
+	}
+	return a;
+}
+
+// sorted by key, equal keys in input order and each payload still with its record
+
+static bool stable_sorted(const wide *a, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		if(a[i].pad[0] != a[i].idx*7 || a[i].pad[5] != a[i].idx*7 + 5) return false;
+		
+		if(i && (a[i-1].key > a[i].key || (a[i-1].key == a[i].key && a[i-1].idx > a[i].idx)))
+			return false;
+	}
+	return true;
+}
+
+static bool is_permutation(const wide *a, size_t n) {
+	std::vector<char> seen(n, 0);
+	
+	for(size_t i = 0; i < n; i++) {
+		if(a[i].idx >= n || seen[a[i].idx]) return false;
+		seen[a[i].idx] = 1;
+	}
+	return true;
+}
+
+// the iterator form, the pointer form with each buffer length and a caller's buffer
+
+static void check_sort() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<wide> a = make_wide(n, mods[m]), b = a;
+			
+			logsort(b.begin(), b.end(), by_key());
+			CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+			
+			for(size_t l = 0; l < sizeof(bLens)/sizeof(*bLens); l++) {
+				std::vector<wide> buf(bLens[l]);
+				
+				b = a;
+				logsort(b.data(), n, bLens[l], by_key());
+				CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+				
+				b = a; // no buffer or a short one falls back to the stack
+				logsort_scratch(b.data(), n, bLens[l] ? buf.data() : NULL, bLens[l], by_key());
+				CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+			}
+		}
+	}
+}
+
+// primitive keys with std::less, compared bitwise with std::stable_sort so that the order
+// of -0.0 and 0.0 counts.  Up to 64 32-bit keys go through the sorting network
+
+template<class T>
+static void check_keys() {
+	static const size_t keySizes[] = {0, 1, 2, 3, 17, 64, 65, 100, 5000, 100000};
+	
+	for(size_t s = 0; s < sizeof(keySizes)/sizeof(*keySizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = keySizes[s];
+			std::vector<T> a(n);
+			
+			for(size_t i = 0; i < n; i++) {
+				a[i] = (T)(int64_t)(mods[m] ? rand64() % mods[m] - mods[m]/2 : rand64());
+				if(a[i] == 0 && rand64() & 1) a[i] = -a[i];
+			}
+			std::vector<T> r = a, b = a;
+			std::stable_sort(r.begin(), r.end());
+			
+			logsort(b.begin(), b.end());
+			CHECK(!n || !memcmp(b.data(), r.data(), n * sizeof(T)));
+			
+			b = a;
+			logsort(b.data(), n, 16);
+			CHECK(!n || !memcmp(b.data(), r.data(), n * sizeof(T)));
+#if __cplusplus >= 201402L
+			b = a;
+			logsort(b.begin(), b.end(), std::less<>());
+			CHECK(!n || !memcmp(b.data(), r.data(), n * sizeof(T)));
+#endif
+		}
+	}
+}
+
+// a predicate with state: keys divisible by its divisor go first, and it counts its calls
+
+struct divisible {
+	uint32_t d;
+	size_t *calls;
+	
+	bool operator()(const wide &a) const { ++*calls; return a.key % d == 0; }
+};
+
+// both sides in input order and the boundary at the first record failing the predicate
+
+static bool stably_partitioned(const wide *a, const wide *p, size_t n, uint32_t d) {
+	for(size_t i = 0; i < n; i++) {
+		if((a+i < p) != (a[i].key % d == 0)) return false;
+		if(i && a+i != p && a[i-1].idx > a[i].idx) return false;
+	}
+	return true;
+}
+
+static void check_partition() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s], calls = 0;
+			std::vector<wide> a = make_wide(n, mods[m]), b = a;
+			divisible pred = {3, &calls};
+			
+			std::vector<wide>::iterator p = log_stable_partition(b.begin(), b.end(), pred);
+			CHECK(is_permutation(b.data(), n) && stably_partitioned(b.data(), b.data() + (p - b.begin()), n, 3));
+			CHECK(calls >= n);
+			
+			for(size_t l = 0; l < sizeof(bLens)/sizeof(*bLens); l++) {
+				b = a;
+				wide *q = log_stable_partition(b.data(), n, pred, bLens[l]);
+				CHECK(is_permutation(b.data(), n) && stably_partitioned(b.data(), q, n, 3));
+			}
+		}
+	}
+}
+
+static bool same_wide(const wide *a, const wide *b, size_t n) {
+	for(size_t i = 0; i < n; i++) if(a[i].idx != b[i].idx) return false;
+	return true;
+}
+
+// the rank k record, the k smallest and the k largest match a stable sort, with k at both ends
+
+static void check_select() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s], ks[] = {0, 1, n/2, n-1, n};
+			std::vector<wide> a = make_wide(n, mods[m]), r = a;
+			std::stable_sort(r.begin(), r.end(), by_key());
+			
+			for(size_t j = 0; j < sizeof(ks)/sizeof(*ks); j++) {
+				size_t k = ks[j];
+				if(k > n) continue;
+				
+				std::vector<wide> b = a;
+				logsort_select(b.begin(), b.begin() + k, b.end(), by_key());
+				CHECK(is_permutation(b.data(), n) && (k == n || b[k].idx == r[k].idx));
+				
+				b = a;
+				logsort_partial(b.begin(), b.begin() + k, b.end(), by_key());
+				CHECK(is_permutation(b.data(), n) && same_wide(b.data(), r.data(), k));
+				
+				b = a;
+				logsort_topk(b.data(), n, k, 16, by_key());
+				CHECK(is_permutation(b.data(), n) && same_wide(b.data() + n-k, r.data() + n-k, k));
+			}
+		}
+	}
+}
+
+// adjacent sorted runs split anywhere, including empty ones, merged through each overload,
+// and an unsorted batch appended to a sorted run
+
+static void check_merge() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s], ks[] = {0, 1, n/3, n/2, n-1, n};
+			std::vector<wide> a = make_wide(n, mods[m]);
+			
+			for(size_t j = 0; j < sizeof(ks)/sizeof(*ks); j++) {
+				size_t k = ks[j];
+				if(k > n) continue;
+				
+				std::vector<wide> runs = a, b, buf(16);
+				std::stable_sort(runs.begin(), runs.begin() + k, by_key());
+				std::stable_sort(runs.begin() + k, runs.end(), by_key());
+				
+				b = runs;
+				logmerge(b.begin(), b.begin() + k, b.end(), by_key());
+				CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+				
+				b = runs; // shorter runs than the buffer take the linear merge
+				logmerge(b.data(), k, n-k, buf.data(), buf.size(), by_key());
+				CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+				
+				b = a;
+				std::stable_sort(b.begin(), b.begin() + k, by_key());
+				logmerge_append(b.data(), k, n-k, by_key());
+				CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+			}
+		}
+	}
+}
+
+// records through temporary files, in memory and in multi-pass merges, plain keys with
+// std::less, and no memory for runs
+
+static void check_file() {
+	static const size_t mems[] = {64 * sizeof(wide), 1 << 22};
+	
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			for(size_t i = 0; i < sizeof(mems)/sizeof(*mems); i++) {
+				size_t n = sizes[s];
+				std::vector<wide> a = make_wide(n, mods[m]), b(n+1);
+				FILE *in = tmpfile(), *out = tmpfile();
+				
+				if(!in || !out) { printf("no temporary files\n"); exit(1); }
+				
+				fwrite(a.data(), sizeof(wide), n, in);
+				rewind(in);
+				CHECK(logsort_file<wide>(in, out, mems[i], 1 << 17, by_key()) == 0);
+				
+				rewind(out); // exactly n records come out
+				CHECK(fread(b.data(), sizeof(wide), n+1, out) == n && is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+				fclose(in); fclose(out);
+				
+				std::vector<uint32_t> k(n), r(n+1);
+				for(size_t j = 0; j < n; j++) k[j] = a[j].key;
+				
+				in = tmpfile(); out = tmpfile();
+				if(!in || !out) { printf("no temporary files\n"); exit(1); }
+				
+				fwrite(k.data(), sizeof(uint32_t), n, in);
+				rewind(in);
+				CHECK(logsort_file<uint32_t>(in, out, mems[i] / 4, 1 << 17) == 0);
+				
+				std::sort(k.begin(), k.end());
+				rewind(out);
+				CHECK(fread(r.data(), sizeof(uint32_t), n+1, out) == n && std::equal(k.begin(), k.end(), r.begin()));
+				fclose(in); fclose(out);
+			}
+		}
+	}
+	FILE *in = tmpfile(), *out = tmpfile();
+	
+	CHECK(in && out && logsort_file<wide>(in, out, 0, 1 << 17, by_key()) == -1);
+	if(in) fclose(in);
+	if(out) fclose(out);
+}
+
+// radix sorting records by a key function, and plain integers: 32 and 64-bit ones take the
+// vectorised partitions, narrower ones the key function instantiation
+
+struct radix_key {
+	int32_t operator()(const wide &a) const { return (int32_t)a.key; }
+};
+
+template<class T>
+static void check_radix_ints() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<T> a(n);
+			
+			for(size_t i = 0; i < n; i++) a[i] = (T)(int64_t)(mods[m] ? rand64() % mods[m] - mods[m]/2 : rand64());
+			if(n > 2) { a[0] = std::numeric_limits<T>::min(); a[1] = std::numeric_limits<T>::max(); }
+			
+			std::vector<T> r = a, b = a;
+			std::sort(r.begin(), r.end());
+			
+			logsort_radix(b.begin(), b.end());
+			CHECK(b == r);
+			
+			b = a;
+			logsort_radix(b.data(), n, 16);
+			CHECK(b == r);
+		}
+	}
+}
+
+static void check_radix() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<wide> a = make_wide(n, mods[m]);
+			
+			for(size_t i = 0; i < n; i++) a[i].key ^= 1u << 31; // signed order differs from unsigned
+			
+			std::vector<wide> r = a, b = a;
+			std::stable_sort(r.begin(), r.end(), [](const wide &x, const wide &y) { return (int32_t)x.key < (int32_t)y.key; });
+			
+			logsort_radix(b.begin(), b.end(), radix_key());
+			CHECK(is_permutation(b.data(), n) && same_wide(b.data(), r.data(), n));
+			
+			b = a;
+			logsort_radix(b.data(), n, 9, radix_key());
+			CHECK(is_permutation(b.data(), n) && same_wide(b.data(), r.data(), n));
+		}
+	}
+	check_radix_ints<int8_t>();
+	check_radix_ints<uint16_t>();
+	check_radix_ints<int32_t>();
+	check_radix_ints<uint32_t>();
+	check_radix_ints<int64_t>();
+	check_radix_ints<uint64_t>();
+}
+
+static void check_indirect() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<wide> a = make_wide(n, mods[m]), b = a, c = a;
+			
+			logsort_indirect(a.data(), n, by_key());
+			CHECK(is_permutation(a.data(), n) && stable_sorted(a.data(), n));
+			
+			logsort_indirect(b.data(), n, key_prefix(), by_key());
+			CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+			
+			// argsort leaves the records in place
+			
+			std::vector<size_t> idx(n + 1, (size_t)-1);
+			logsort_argsort(c.data(), idx.data(), n, by_key());
+			
+			bool ok = idx[n] == (size_t)-1;
+			for(size_t i = 0; i < n; i++) {
+				ok &= c[i].idx == i && idx[i] < n;
+				if(ok && i) ok &= c[idx[i-1]].key < c[idx[i]].key || (c[idx[i-1]].key == c[idx[i]].key && idx[i-1] < idx[i]);
+			}
+			CHECK(ok);
+		}
+	}
+}
+
+// two key columns, the row index and a payload moved along the cycles of the permutation
+
+static void check_columns() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<uint8_t> k0(n);
+			std::vector<int32_t> k1(n);
+			std::vector<uint32_t> id(n);
+			std::vector<std::string> name(n);
+			std::vector<size_t> ref(n);
+			
+			for(size_t i = 0; i < n; i++) {
+				k0[i] = (uint8_t)(rand64() % 3);
+				k1[i] = (int32_t)(mods[m] ? rand64() % mods[m] : rand64());
+				id[i] = (uint32_t)i;
+				name[i] = std::to_string(i);
+				ref[i] = i;
+			}
+			std::vector<uint8_t> r0 = k0;
+			std::vector<int32_t> r1 = k1;
+			std::stable_sort(ref.begin(), ref.end(), [&](size_t x, size_t y) {
+				return r0[x] < r0[y] || (r0[x] == r0[y] && r1[x] < r1[y]);
+			});
+			
+			CHECK(logsort_columns(n, std::make_tuple(k0.data(), k1.data()), std::make_tuple(id.data(), name.data())) == 0);
+			
+			bool ok = true;
+			for(size_t i = 0; i < n && ok; i++)
+				ok = id[i] == ref[i] && k0[i] == r0[ref[i]] && k1[i] == r1[ref[i]] && name[i] == std::to_string(ref[i]);
+			CHECK(ok);
+		}
+	}
+}
+
+// segments of up to 40 records, some empty, sorted one by one and on all threads
+
+static void check_segmented() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			std::vector<wide> a = make_wide(n, mods[m]);
+			std::vector<size_t> off(1, 0);
+			
+			while(off.back() < n) off.push_back(std::min(n, off.back() + (size_t)(rand64() % 41)));
+			size_t nseg = off.size() - 1;
+			
+			std::vector<wide> b = a;
+			logsort_segmented(b.data(), off.data(), nseg, LOGSORT_AUTO, by_key());
+			
+			bool ok = is_permutation(b.data(), n);
+			for(size_t i = 0; i < nseg; i++) ok &= stable_sorted(b.data() + off[i], off[i+1]-off[i]);
+			CHECK(ok);
+#ifdef _OPENMP
+			b = a;
+			logsort_segmented_parallel(b.data(), off.data(), nseg, LOGSORT_AUTO, by_key());
+			
+			ok = is_permutation(b.data(), n);
+			for(size_t i = 0; i < nseg; i++) ok &= stable_sorted(b.data() + off[i], off[i+1]-off[i]);
+			CHECK(ok);
+			
+			b = a;
+			logsort_parallel(b.begin(), b.end(), by_key());
+			CHECK(is_permutation(b.data(), n) && stable_sorted(b.data(), n));
+#endif
+		}
+	}
+}
+
+#ifdef LOGSORT_STATS
+
+// the counters of logStats.h against a comparator counting its own calls, after a reset
+
+struct counted {
+	unsigned long long *calls;
+	
+	bool operator()(const wide &a, const wide &b) const { ++*calls; return a.key < b.key; }
+};
+
+static void check_stats() {
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+		for(size_t m = 0; m < sizeof(mods)/sizeof(*mods); m++) {
+			size_t n = sizes[s];
+			unsigned long long calls = 0, moves = 0, bytes = 0;
+			std::vector<wide> a = make_wide(n, mods[m]);
+			counted comp = {&calls};
+			
+			log_stats_reset();
+			CHECK(log_stats_cmps() == 0);
+			
+			logsort(a.begin(), a.end(), comp);
+			CHECK(is_permutation(a.data(), n) && stable_sorted(a.data(), n));
+			
+			const log_stats *st = log_stats_get();
+			for(int i = 0; i < LOG_STATS_DEPTH; i++) { moves += st->depth[i].moves; bytes += st->depth[i].bytes; }
+			for(int i = 0; i < LOG_PHASES; i++) { moves -= st->phase[i].moves; bytes -= st->phase[i].bytes; }
+			
+			CHECK(log_stats_cmps() == calls && !moves && !bytes);
+		}
+	}
+}
+
+#endif
+
+int main() {
+	check_sort();
+	check_keys<int32_t>();
+	check_keys<uint32_t>();
+	check_keys<float>();
+	check_keys<int64_t>();
+	check_keys<uint64_t>();
+	check_keys<double>();
+	check_partition();
+	check_select();
+	check_merge();
+	check_file();
+	check_radix();
+	check_indirect();
+	check_columns();
+	check_segmented();
+#ifdef LOGSORT_STATS
+	check_stats();
+#endif
+	
+	printf("checkHpp: %d failed\n", failures);
+	return failures != 0;
+}
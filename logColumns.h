@@ -0,0 +1,159 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGCOLUMNS_H
+#define LOGCOLUMNS_H
+
+// columnar sorting: logsort_columns stably sorts n rows stored as c parallel columns by the
+// columns with a comparator, in order of significance, and moves every column into the
+// same order.  Rows are never packed: a row index is sorted by comparing the key columns,
+// then each column in turn is gathered into that order through a buffer of up to 16 bytes
+// per row, or if it is wider or the buffer cannot be allocated, follows the cycles of the
+// permutation one element at a time.  Visited indices are marked in their top bit so the
+// index survives every column.
+//
+// A tag is just the row index; the comparator finds the columns through a thread-local
+// context that each call sets and restores on return, so calls may run on several threads
+// at once and a comparator may itself sort columns.  It returns -1 if the tags cannot be
+// allocated, else 0.
+// Like logsort.h, include it in one translation unit only.  In C++, logsort_columns in
+// logsort.hpp takes tuples of typed key and payload columns and inlines the comparisons.
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	void *data;  // n elements of size bytes
+	size_t size;
+	int (*cmp)(const void *a, const void *b); // as for qsort, NULL for payload columns
+} log_column;
+
+typedef size_t log_coltag;
+
+#define LOG_VISITED ((size_t)1 << (sizeof(size_t)*8 - 1))
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+	#define LOG_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+	#define LOG_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+	#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+	#define LOG_THREAD_LOCAL __thread
+#endif
+
+// the columns of the innermost logsort_columns call running on this thread
+static LOG_THREAD_LOCAL const log_column *log_coltag_col;
+static LOG_THREAD_LOCAL size_t log_coltag_c;
+
+static inline int log_coltag_cmp(const log_coltag *a, const log_coltag *b) {
+	size_t k;
+	
+	for(k = 0; k < log_coltag_c; k++) {
+		const log_column *p = log_coltag_col + k;
+		
+		if(!p->cmp) continue;
+		
+		int r = p->cmp((const char*)p->data + *a * p->size, (const char*)p->data + *b * p->size);
+		if(r) return r;
+	}
+	return 0;
+}
+
+#define LOGSORT_PREFIX log_coltag
+#define VAR log_coltag
+#define CMP(a, b) (log_coltag_cmp((a), (b)))
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+
+// moves a[idx[i]] to a+i for elements of size bytes and leaves idx unchanged: gathered
+// through buf if the column fits in bufBytes, else along the cycles of idx through t
+
+void log_column_apply(char *a, size_t size, size_t *idx, size_t n, char *t, char *buf, size_t bufBytes) {
+	size_t i, j, k;
+	
+	if(n * size <= bufBytes) {
+		for(i = 0; i < n; i++) memcpy(buf + i*size, a + idx[i]*size, size);
+		memcpy(a, buf, n * size);
+		return;
+	}
+	for(i = 0; i < n; i++) {
+		if(idx[i] & LOG_VISITED) continue;
+		
+		memcpy(t, a + i*size, size); j = i;
+		
+		while((k = idx[j]) != i) {
+			memcpy(a + j*size, a + k*size, size);
+			idx[j] |= LOG_VISITED; j = k;
+		}
+		memcpy(a + j*size, t, size);
+		idx[j] |= LOG_VISITED;
+	}
+	for(i = 0; i < n; i++) idx[i] &= ~LOG_VISITED;
+}
+
+int logsort_columns(log_column *col, size_t c, size_t n) {
+	size_t i, k, size = 0, bufSize = 0;
+	
+	if(n < 2) return 0;
+	
+	for(k = 0; k < c; k++) {
+		if(col[k].size > size) size = col[k].size;
+		if(col[k].size > bufSize && col[k].size <= 2*sizeof(size_t)) bufSize = col[k].size;
+	}
+	log_coltag *idx = (log_coltag*)malloc(n * sizeof(log_coltag));
+	char *tmp = (char*)malloc(size);
+	
+	if(!idx || !tmp) {
+		free(idx);
+		free(tmp);
+		return -1;
+	}
+	for(i = 0; i < n; i++) idx[i] = i;
+	
+	const log_column *prevCol = log_coltag_col; // a comparator may sort columns itself
+	size_t prevC = log_coltag_c;
+	
+	log_coltag_col = col; log_coltag_c = c;
+	log_coltag_logsort(idx, n, LOGSORT_AUTO);
+	log_coltag_col = prevCol; log_coltag_c = prevC;
+	
+	char *buf = bufSize ? (char*)malloc(n * bufSize) : NULL; // only after sorting, to keep the peak low
+	if(!buf) bufSize = 0;
+	
+	for(k = 0; k < c; k++)
+		log_column_apply((char*)col[k].data, col[k].size, idx, n, tmp, buf, n * bufSize);
+	
+	free(buf);
+	free(tmp);
+	free(idx);
+	
+	return 0;
+}
+
+#endif // LOGCOLUMNS_H
@@ -0,0 +1,165 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+
+// external sorting of a stream of VAR records larger than memory: chunks filling memBytes
+// are sorted by logsort, which needs only bLen elements besides the chunk, and written to
+// temporary files as runs.  The runs are merged k ways through read buffers sharing ioBytes,
+// in several passes if there are too many runs for blocks of LOG_EXT_BLOCK bytes each.
+// Ties go to the earlier run, so equal records keep their order in the input
+
+#define LOG_EXT_BLOCK 65536
+
+// merges the c runs f[0, c) into out, with cap records of buffer per run and for output
+
+int log_ext_merge(FILE **f, size_t c, FILE *out, VAR *buf, size_t cap, size_t *h) {
+	size_t *pos = h+c, *len = pos+c, i, j, m, hn = 0, on = 0;
+	VAR *o = buf + c*cap;
+	int err = 0;
+	
+	#define LOG_EXT_HEAD(i) (buf + (i)*cap + pos[i])
+	#define LOG_EXT_LESS(i, j) ((i) < (j) ? CMP(LOG_EXT_HEAD(i), LOG_EXT_HEAD(j)) <= 0 \
+	                                      : CMP(LOG_EXT_HEAD(j), LOG_EXT_HEAD(i)) > 0)
+	
+	for(i = 0; i < c; i++) {
+		rewind(f[i]);
+		pos[i] = 0;
+		len[i] = fread(buf + i*cap, sizeof(VAR), cap, f[i]);
+		
+		if(len[i]) h[hn++] = i;
+	}
+	for(m = hn/2; m--; ) { // heapify
+		for(i = m; (j = 2*i+1) < hn; i = j) {
+			if(j+1 < hn && LOG_EXT_LESS(h[j+1], h[j])) j++;
+			if(!LOG_EXT_LESS(h[j], h[i])) break;
+			
+			size_t t = h[i]; h[i] = h[j]; h[j] = t;
+		}
+	}
+	while(hn) {
+		m = h[0];
+		o[on++] = *LOG_EXT_HEAD(m);
+		
+		if(on == cap) {
+			if(fwrite(o, sizeof(VAR), on, out) != on) { err = -1; break; }
+			on = 0;
+		}
+		if(++pos[m] == len[m]) { // refill
+			pos[m] = 0;
+			len[m] = fread(buf + m*cap, sizeof(VAR), cap, f[m]);
+			
+			if(!len[m]) {
+				if(ferror(f[m])) { err = -1; break; }
+				h[0] = h[--hn];
+			}
+		}
+		for(i = 0; (j = 2*i+1) < hn; i = j) { // sift down
+			if(j+1 < hn && LOG_EXT_LESS(h[j+1], h[j])) j++;
+			if(!LOG_EXT_LESS(h[j], h[i])) break;
+			
+			size_t t = h[i]; h[i] = h[j]; h[j] = t;
+		}
+	}
+	#undef LOG_EXT_HEAD
+	#undef LOG_EXT_LESS
+	
+	if(!err && fwrite(o, sizeof(VAR), on, out) != on) err = -1;
+	
+	return err;
+}
+
+// sorts the records of in to out using about memBytes for runs and ioBytes for merging.
+// Returns 0, or -1 if memory or a temporary file could not be allocated or I/O failed
+
+int logsort_file(FILE *in, FILE *out, size_t memBytes, size_t ioBytes) {
+	size_t n = memBytes / sizeof(VAR), bLen = log_auto_blen(sizeof(VAR), n), r, k = 0, cap = 0, i, j;
+	FILE **f = NULL, **g, *t;
+	VAR *a;
+	int err = 0;
+	
+	if(bLen > n/2) bLen = n/2;
+	n -= bLen;
+	
+	if(!n || !(a = (VAR*)malloc(memBytes))) return -1;
+	
+	// sorted runs
+	
+	while((r = fread(a, sizeof(VAR), n, in)) > 0) {
+		logsort_scratch(a, r, a+n, bLen);
+		
+		if(!k && r < n) { // fits in memory
+			if(fwrite(a, sizeof(VAR), r, out) != r) err = -1;
+			break;
+		}
+		if(k == cap) {
+			cap = cap ? 2*cap : 16;
+			
+			if(!(g = (FILE**)realloc(f, cap * sizeof(FILE*)))) { err = -1; break; }
+			f = g;
+		}
+		if(!(f[k] = tmpfile())) { err = -1; break; }
+		if(fwrite(a, sizeof(VAR), r, f[k++]) != r) { err = -1; break; }
+		
+		if(r < n) break;
+	}
+	if(ferror(in)) err = -1;
+	free(a);
+	
+	// merge passes
+	
+	size_t fan = ioBytes / LOG_EXT_BLOCK > 3 ? ioBytes / LOG_EXT_BLOCK - 1 : 2;
+	size_t per = ioBytes / sizeof(VAR), c = k < fan ? k : fan;
+	
+	VAR  *buf = (VAR*)malloc((per > 2*c ? per : 2*c) * sizeof(VAR));
+	size_t *h = (size_t*)malloc(3*c * sizeof(size_t));
+	
+	if(k && (!buf || !h)) err = -1;
+	
+	while(!err && k > fan) {
+		for(i = j = 0; !err && i < k; i += fan, j++) {
+			c = k-i < fan ? k-i : fan;
+			
+			if(!(t = tmpfile())) { err = -1; break; }
+			
+			err = log_ext_merge(f+i, c, t, buf, per/(c+1) ? per/(c+1) : 1, h);
+			
+			for(r = i; r < i+c; r++) fclose(f[r]);
+			f[j] = t;
+		}
+		for(r = i; r < k; r++) fclose(f[r]); // after an error
+		k = j;
+	}
+	if(!err && k) err = log_ext_merge(f, k, out, buf, per/(k+1) ? per/(k+1) : 1, h);
+	
+	for(i = 0; i < k; i++) fclose(f[i]);
+	
+	free(buf);
+	free(h);
+	free(f);
+	
+	return err;
+}
+
+#undef LOG_EXT_BLOCK
@@ -24,19 +24,35 @@ SOFTWARE.
  *
  */
 
-size_t PIVFUNC(log_block_read)(VAR *a, VAR *piv, char wLen) {
+size_t PIVFUNC(log_block_read)(VAR *a, PIVTYPE *piv, char wLen) {
+#ifdef LOGSORT_PRED
+	(void)piv; // the predicate is inlined rather than passed
+#endif
+#if defined(LOGSORT_KEY) && defined(PIVOP)
+	log_read_fn read = log_simd_read(LOGSORT_KEY, PIVOP);
+	
+	if(read) {
+		LOG_STAT_CMP(wLen);
+		return read(a, piv, wLen);
+	}
+#endif
 	size_t r = 0, i = 0;
 	
-	while(wLen--) r |= PIVCMP(a++, piv) << (i++);
+	for(; wLen--; i++) r |= (size_t)PIVCMP(a+i, piv) << i;
 	
 	return r;
 }
 
-VAR *PIVFUNC(log_partition_easy)(VAR *array, VAR *swap, size_t n, VAR *piv) {
+VAR *PIVFUNC(log_partition_easy)(VAR *array, VAR *swap, size_t n, PIVTYPE *piv) {
 	size_t c, x, y;
 	VAR *a = array, *b = a+n-1, *i = a, *j = b;
 	VAR *swapEnd = swap+n, *pa = swap, *pb = swapEnd-1;
 	
+#ifdef LOGSORT_PRED
+	(void)piv;
+#endif
+	LOG_STAT_ENTER(LOG_PH_GROUP);
+	
 	for(c = n/2; c; c--) {
 		x = PIVCMP(i, piv);
 		*a = *i; *pa = *i; i++; a += x; pa += !x;
@@ -48,21 +64,196 @@ VAR *PIVFUNC(log_partition_easy)(VAR *array, VAR *swap, size_t n, VAR *piv) {
 		x = PIVCMP(i, piv);
 		*a = *i; *pa = *i; i++; a += x; pa += !x;
 	}
+	LOG_STAT_MOVES(2*n + (pa-swap) + (swapEnd-1 - pb));
+	
 	while(++pb < swapEnd) *a++ = *pb;
 	while(pa-- > swap)    *b-- = *pa;
 	
+	LOG_STAT_LEAVE();
 	return a;
 }
-VAR *PIVFUNC(log_partition)(VAR *a, VAR *s, size_t n, size_t bLen, VAR *piv) {
+
+#ifdef LOGSORT_MIN_CMP
+
+// log_block_partition for expensive comparisons: one comparison per block caches its type,
+// and the smaller partition's blocks their ranks, in w bit fields of the free buffer c.
+// No tags are encoded and the cycle sort reads destinations from the fields instead of
+// decoding wLen comparisons per block
+
+void PIVFUNC(log_block_partition_cached)(VAR *a, unsigned char *c, size_t lb, size_t rb, size_t bLen, char w, PIVTYPE *piv) {
+	char left = lb < rb, x;
+	size_t i, j, k, f, b = lb+rb, min = left ? lb : rb, max = b - min, v = 0;
+	
+#ifdef LOGSORT_PRED
+	(void)piv;
+#endif
+	LOG_STAT_ENTER(LOG_PH_ENCODE);
+	
+	for(i = 0; i < b; i++) {
+		x = PIVCMP(a + i*bLen, piv);
+		log_bits_set(c, i, w, x == left ? v++ << 1 | x : (size_t)x);
+	}
+	
+	// swap blocks of larger partition
+	
+	LOG_STAT_SET(LOG_PH_SWAP);
+	size_t qa = left ? b-1 : 0, qb = qa, step = left ? -1 : 1;
+	
+	for(i = 0; i < max; ) {
+		f = log_bits_get(c, qb, w);
+		
+		if(left ^ (f & 1)) {
+			log_swap_bytes(a + qa*bLen, a + qb*bLen, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			
+			log_bits_set(c, qb, w, log_bits_get(c, qa, w));
+			log_bits_set(c, qa, w, f);
+			qa += step; i++;
+		}
+		qb += step;
+	}
+	
+	// block cycle sort by the cached ranks
+	
+	LOG_STAT_SET(LOG_PH_CYCLE);
+	VAR *ps = left ? a : a + lb*bLen;
+	qa = left ? 0 : lb;
+	
+	for(i = 0; i < min; i++) {
+		j = log_bits_get(c, qa+i, w) >> 1;
+		
+		while(j != i) {
+			f = log_bits_get(c, qa+j, w);
+			k = f >> 1;
+			
+			if(k != i) log_prefetch(ps + k*bLen, bLen * sizeof(VAR));
+			
+			log_swap_bytes(ps + i*bLen, ps + j*bLen, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			
+			log_bits_set(c, qa+j, w, log_bits_get(c, qa+i, w));
+			log_bits_set(c, qa+i, w, f);
+			j = k;
+		}
+	}
+	LOG_STAT_LEAVE();
+}
+
+#endif
+
+// stably sorts lb 0 blocks and rb 1 blocks of bLen elements: tags are encoded in pairs of
+// 0 and 1 blocks, the larger partition is block swapped into place and the scrambled blocks
+// are cycle sorted back into order by their tags
+
+void PIVFUNC(log_block_partition)(VAR *a, VAR *s, size_t lb, size_t rb, size_t bLen, PIVTYPE *piv) {
+	char left = lb < rb;
+	size_t min = left ? lb : rb;
+	
+	if(!min) return;
+	
+	VAR *p = a + (lb+rb)*bLen, *m = a + lb*bLen;
+	size_t i, max = lb+rb - min, v = 0;
+	char wLen = log_ceil_log(min);
+	
+#ifdef LOGSORT_MIN_CMP
+	if((lb+rb) * (wLen+1) <= bLen * sizeof(VAR) * 8) {
+		PIVFUNC(log_block_partition_cached)(a, (unsigned char*)s, lb, rb, bLen, wLen+1, piv);
+		return;
+	}
+#else
+	(void)s; // blocks are swapped in place, the buffer only holds the cache
+#endif
+	// encode bits in blocks
+	
+	LOG_STAT_ENTER(LOG_PH_ENCODE);
+	VAR *pa = a, *pb = a;
+	
+	for(i = 0; i < min; i++) {
+		while(!PIVCMP(pa+wLen, piv)) pa += bLen;
+		while( PIVCMP(pb+wLen, piv)) pb += bLen;
+		
+		log_block_xor(pa, pb, v++); 
+		pa += bLen; pb += bLen;
+	}
+	
+	// swap blocks of larger partition
+	
+	LOG_STAT_SET(LOG_PH_SWAP);
+	pa = left ? p-bLen : a; pb = pa;
+	size_t step = left ? -bLen : bLen;
+	
+	for(i = 0; i < max; ) {
+		if(left ^ PIVCMP(pb+wLen, piv)) {
+			log_swap_bytes(pa, pb, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			
+			pa += step; i++;
+		}
+		pb += step;
+	}
+	
+	// block cycle sort: the block swapped into pa is decoded before the swap, so the next
+	// block of the cycle can be prefetched while this one moves
+	
+	LOG_STAT_SET(LOG_PH_CYCLE);
+	size_t j, k, mask = (left << wLen) - left; v = 0;
+	VAR *ps = left ? a : m; pa = ps; pb = left ? m : a;
+	
+	for(i = 0; i < min; i++) {
+		j = mask ^ PIVFUNC(log_block_read)(pa, piv, wLen);
+		
+		while(j != v) {
+			VAR *pj = ps + j*bLen;
+			k = mask ^ PIVFUNC(log_block_read)(pj, piv, wLen);
+			
+			if(k != v) log_prefetch(ps + k*bLen, bLen * sizeof(VAR));
+			
+			log_swap_bytes(pa, pj, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			j = k;
+		}
+		log_block_xor(pa, pb, v++);
+		pa += bLen; pb += bLen;
+	}
+	LOG_STAT_LEAVE();
+}
+
+VAR *PIVFUNC(log_partition)(VAR *a, VAR *s, size_t n, size_t bLen, PIVTYPE *piv) {
 	if(n <= bLen) return PIVFUNC(log_partition_easy)(a, s, n, piv);
 	
+	char split = (size_t)log_ceil_log(n / (2*bLen)) >= bLen; // blocks too short for their tags
+#ifdef LOGSORT_MIN_CMP
+	split |= n/bLen * (log_ceil_log(n / (2*bLen)) + 1) > bLen * sizeof(VAR) * 8; // or buffer for their cache
+#endif
+	
+	if(split) { // partition halves and rotate
+		VAR *m = a + n/2;
+		VAR *p = PIVFUNC(log_partition)(a, s, n/2, bLen, piv);
+		VAR *q = PIVFUNC(log_partition)(m, s, n - n/2, bLen, piv);
+		
+		return log_rotate(p, m, q);
+	}
+	
 	// group into blocks
 	
 	VAR *p;
-	size_t i, l = 0, r = 0, lb, rb = 0, rem;
+	size_t i = 0, l = 0, r = 0, lb, rb = 0, rem;
 	char x;
+	
+	LOG_STAT_ENTER(LOG_PH_GROUP);
+	
+#if defined(LOGSORT_KEY) && defined(PIVOP)
+	log_group_fn group = log_simd_group(LOGSORT_KEY, PIVOP); // vectorised grouping
+	
+	if(group) {
+		size_t g[4] = {0, 0, 0, 0};
+		group(a, s, piv, n, bLen, g, g+1, g+2, g+3);
+		i = g[0]; l = g[1]; r = g[2]; rb = g[3];
+		LOG_STAT_CMP(i);
+	}
+#endif
 
-	for(i = 0; i < n; i++) { // branchless partitioning from fluxsort
+	for(; i < n; i++) { // branchless partitioning from fluxsort
 		x = PIVCMP(a+i, piv);
 		a[l] = a[i]; s[r] = a[i];
 		l += x; r += !x;
@@ -78,72 +269,54 @@ VAR *PIVFUNC(log_partition)(VAR *a, VAR *s, size_t n, size_t bLen, VAR *piv) {
 			l += bLen; r = 0; rb++;
 		}
 	}
+	LOG_STAT_MOVES(2*n);
+	
 	p = a+l;
 	memcpy(p, s, r * sizeof(VAR));
 	l %= bLen; p -= l;
 	lb = (n-r)/bLen - rb;
 	
-	char left = lb < rb;
-	size_t min = left ? lb : rb;
 	VAR *m = a + lb*bLen;
 	
-	if(min) {
-		size_t max = lb+rb - min, v = 0;
-		char wLen = log_ceil_log(min);
-		
-		// encode bits in blocks
-		
-		VAR *pa = a, *pb = a;
-		
-		for(i = 0; i < min; i++) {
-			while(!PIVCMP(pa+wLen, piv)) pa += bLen;
-			while( PIVCMP(pb+wLen, piv)) pb += bLen;
-			
-			log_block_xor(pa, pb, v++); 
-			pa += bLen; pb += bLen;
-		}
-		
-		// swap blocks of larger partition
-		
-		pa = left ? p-bLen : a; pb = pa;
-		size_t step = left ? -bLen : bLen;
-		
-		for(i = 0; i < max; ) {
-			if(left ^ PIVCMP(pb+wLen, piv)) {
-				memcpy(s,  pa, bLen * sizeof(VAR));
-				memcpy(pa, pb, bLen * sizeof(VAR));
-				memcpy(pb, s,  bLen * sizeof(VAR));
-				
-				pa += step; i++;
-			}
-			pb += step;
-		}
-		
-		// block cycle sort
-		
-		size_t j, mask = (left << wLen) - left; v = 0;
-		VAR *ps = left ? a : m; pa = ps; pb = left ? m : a;
-		
-		for(i = 0; i < min; i++) {
-			j = mask ^ PIVFUNC(log_block_read)(pa, piv, wLen);
-			
-			while(j != v) {
-				memcpy(s,  pa,          bLen * sizeof(VAR));
-				memcpy(pa, ps + j*bLen, bLen * sizeof(VAR));
-				memcpy(ps + j*bLen,  s, bLen * sizeof(VAR));
-				
-				j = mask ^ PIVFUNC(log_block_read)(pa, piv, wLen);
-			}
-			log_block_xor(pa, pb, v++);
-			pa += bLen; pb += bLen;
-		}
-	}
+	PIVFUNC(log_block_partition)(a, s, lb, rb, bLen, piv);
 	
 	// clean up leftovers: shift 0's fragment in place
 	
+	LOG_STAT_SET(LOG_PH_CLEANUP);
 	memcpy(s, p, l * sizeof(VAR));
 	memmove(m+l, m, rb*bLen * sizeof(VAR));
 	memcpy(m, s, l * sizeof(VAR));
 	
+	LOG_STAT_LEAVE();
 	return m+l;
 }
+
+#ifdef _OPENMP
+
+// parallel partition: c chunks are partitioned by separate tasks, each using the bLen
+// buffer of the thread running it, then neighbouring [0's|1's] results are merged
+// pairwise by rotating the 1's of the left chunk with the 0's of the right chunk
+
+VAR *PIVFUNC(log_partition_parallel)(VAR *a, VAR *s, size_t n, size_t bLen, PIVTYPE *piv, size_t c) {
+	VAR *bnd[MAX_PARALLEL_CHUNKS+1], *mid[MAX_PARALLEL_CHUNKS];
+	size_t i, w;
+	
+	for(i = 0; i <= c; i++) bnd[i] = a + i*(n/c) + (i < c ? 0 : n%c);
+	
+	for(i = 0; i < c; i++) {
+		#pragma omp task firstprivate(i) shared(bnd, mid)
+		mid[i] = PIVFUNC(log_partition)(bnd[i], s + omp_get_thread_num()*bLen, bnd[i+1]-bnd[i], bLen, piv);
+	}
+	#pragma omp taskwait
+	
+	for(w = 1; w < c; w *= 2) {
+		for(i = 0; i+w < c; i += 2*w) {
+			#pragma omp task firstprivate(i, w) shared(bnd, mid)
+			mid[i] = log_rotate_parallel(mid[i], bnd[i+w], mid[i+w]);
+		}
+		#pragma omp taskwait
+	}
+	return mid[0];
+}
+
+#endif
@@ -0,0 +1,686 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGSIMD_H
+#define LOGSIMD_H
+
+// vectorised kernels for primitive keys, selected at runtime by CPU support
+//
+// logsort.h uses them when LOGSORT_KEY names the type of VAR (LOG_KEY_I32 etc.) and CMP
+// orders keys ascending.  Floating point keys must not be NaN.  Define LOGSORT_NO_SIMD
+// to disable the kernels or LOG_SIMD_MAX_LEVEL 1 to stay on AVX2.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_KEY_I32 1
+#define LOG_KEY_U32 2
+#define LOG_KEY_F32 3
+#define LOG_KEY_I64 4
+#define LOG_KEY_U64 5
+#define LOG_KEY_F64 6
+
+#define LOG_OP_LT 0 // a < piv
+#define LOG_OP_LE 1 // a <= piv
+
+// group kernel: runs the grouping loop of log_partition over whole vectors and returns
+// with less than one vector of elements left for the scalar loop
+
+typedef void (*log_group_fn)(void *a, void *s, const void *piv, size_t n, size_t bLen,
+                             size_t *i, size_t *l, size_t *r, size_t *rb);
+
+// three-way group kernel: the same for the grouping loop of log_partition_three, with the
+// == and > buckets in s and s+hLen; g holds i, l, r1, r2, b1, b2
+
+typedef void (*log_group3_fn)(void *a, void *s, const void *piv, size_t n, size_t hLen, size_t *g);
+
+// block tag kernels: decode the wLen leading bits of a block / swap the elements of two
+// blocks at the set bits of v
+
+typedef size_t (*log_read_fn)(const void *a, const void *piv, int wLen);
+typedef void   (*log_xor_fn)(void *a, void *b, size_t v);
+
+// small sort kernel: sorts up to 64 integer keys of 32 bits in place
+
+typedef void (*log_sort_fn)(void *a, size_t n);
+
+// batched small sort kernel: sorts c <= LOG_BATCH_SEGS consecutive segments
+// a[off[j], off[j+1]) of up to LOG_BATCH_LEN 32-bit keys at once
+
+typedef void (*log_batch_fn)(void *a, const size_t *off, size_t c);
+
+#define LOG_BATCH_SEGS 8
+#define LOG_BATCH_LEN 16
+
+// block movement: log_swap_bytes swaps two blocks through a chunk that stays in registers
+// or L1 rather than copying both through the buffer, and log_prefetch requests the lines
+// of a block before it is swapped
+
+#define LOG_LINE 64
+#define LOG_SWAP_CHUNK 256
+
+static inline void log_prefetch(const void *p, size_t bytes) {
+#if defined(__GNUC__) || defined(__clang__)
+	const char *c = (const char*)p, *e = c + bytes;
+	
+	for(; c < e; c += LOG_LINE) __builtin_prefetch(c, 1);
+#else
+	(void)p; (void)bytes;
+#endif
+}
+static inline void log_swap_bytes(void *a, void *b, size_t bytes) {
+	char *x = (char*)a, *y = (char*)b, t[LOG_SWAP_CHUNK];
+	
+	for(; bytes >= LOG_SWAP_CHUNK; bytes -= LOG_SWAP_CHUNK, x += LOG_SWAP_CHUNK, y += LOG_SWAP_CHUNK) {
+		memcpy(t, x, LOG_SWAP_CHUNK);
+		memcpy(x, y, LOG_SWAP_CHUNK);
+		memcpy(y, t, LOG_SWAP_CHUNK);
+	}
+	memcpy(t, x, bytes);
+	memcpy(x, y, bytes);
+	memcpy(y, t, bytes);
+}
+
+// the bits of a 32 or 64-bit key
+
+static inline int32_t log_bits32(const void *p) { int32_t x; memcpy(&x, p, 4); return x; }
+static inline int64_t log_bits64(const void *p) { int64_t x; memcpy(&x, p, 8); return x; }
+
+// fields of w bits packed in a byte array, the block cache of LOGSORT_MIN_CMP
+
+static inline size_t log_bits_get(const unsigned char *c, size_t i, char w) {
+	size_t r = 0, k = i*w + w;
+	
+	while(w--) { k--; r = r << 1 | (c[k/8] >> k%8 & 1); }
+	return r;
+}
+static inline void log_bits_set(unsigned char *c, size_t i, char w, size_t v) {
+	size_t k = i*w;
+	
+	for(; w--; k++, v >>= 1) c[k/8] = (unsigned char)((c[k/8] & ~(1 << k%8)) | (v & 1) << k%8);
+}
+
+#if !defined(LOGSORT_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+
+#define LOG_SIMD 1
+
+#ifndef LOG_SIMD_MAX_LEVEL
+	#define LOG_SIMD_MAX_LEVEL 2
+#endif
+
+#include <immintrin.h>
+
+// 0: scalar, 1: AVX2 + BMI2, 2: AVX-512
+
+static inline int log_simd_level(void) {
+	static int level = -1;
+	
+	if(level < 0) {
+		__builtin_cpu_init();
+		
+		int l = __builtin_cpu_supports("avx512f") ? 2
+		      : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") ? 1 : 0;
+		
+		level = l < LOG_SIMD_MAX_LEVEL ? l : LOG_SIMD_MAX_LEVEL;
+	}
+	return level;
+}
+
+// MASK(v, vp) sets bit k when lane k of v goes left of the pivot,
+// STORE writes the left lanes to a+l and the right lanes to s+r,
+// PACK(p, m, v) writes the lanes of v set in m to p
+
+#define LOG_GROUP_KERNEL(NAME, TARGET, T, VEC, W, LOAD, SPLAT, MASK, STORE, OP) \
+__attribute__((target(TARGET)))                                                \
+static void NAME(void *va, void *vs, const void *vpiv, size_t n, size_t bLen,   \
+                 size_t *pi, size_t *pl, size_t *pr, size_t *prb) {             \
+	T *a = (T*)va, *s = (T*)vs, *p, pv = *(const T*)vpiv;                       \
+	size_t i = *pi, l = *pl, r = *pr, rb = *prb, rem, x;                        \
+	VEC vp = SPLAT(vpiv);                                                       \
+	                                                                            \
+	while(i + W <= n) {                                                         \
+		if(r + W <= bLen) {                                                     \
+			VEC v = LOAD(a+i);                                                  \
+			unsigned m = MASK(v, vp);                                           \
+			                                                                    \
+			STORE;                                                              \
+			x = __builtin_popcount(m);                                          \
+			l += x; r += W-x; i += W;                                           \
+		}                                                                       \
+		else {                                                                  \
+			x = a[i] OP pv;                                                     \
+			a[l] = a[i]; s[r] = a[i];                                           \
+			l += x; r += !x; i++;                                               \
+		}                                                                       \
+		if(r == bLen) {                                                         \
+			rem = l % bLen;                                                     \
+			p = a+l - rem;                                                      \
+			                                                                    \
+			memcpy(p+bLen, p, rem * sizeof(T));                                 \
+			memcpy(p, s, bLen * sizeof(T));                                     \
+			                                                                    \
+			l += bLen; r = 0; rb++;                                             \
+		}                                                                       \
+	}                                                                           \
+	*pi = i; *pl = l; *pr = r; *prb = rb;                                       \
+}
+
+#define LOG_GROUP3_KERNEL(NAME, TARGET, T, VEC, W, LOAD, SPLAT, LT, PACK)             \
+__attribute__((target(TARGET)))                                                       \
+static void NAME(void *va, void *vs, const void *vpiv, size_t n, size_t hLen,         \
+                 size_t *g) {                                                         \
+	T *a = (T*)va, *s1 = (T*)vs, *s2 = s1+hLen, *p, *t, pv = *(const T*)vpiv;          \
+	size_t i = g[0], l = g[1], r1 = g[2], r2 = g[3], b1 = g[4], b2 = g[5], rem, x, y;  \
+	VEC vp = SPLAT(vpiv);                                                              \
+	                                                                                   \
+	while(i + W <= n) {                                                                \
+		if(r1 + W <= hLen && r2 + W <= hLen) {                                         \
+			VEC v = LOAD(a+i);                                                         \
+			unsigned lt = LT(v, vp), gt = LT(vp, v);                                   \
+			                                                                           \
+			PACK(a+l, lt, v); PACK(s2+r2, gt, v);                                      \
+			PACK(s1+r1, ((1u << W) - 1) ^ lt ^ gt, v);                                 \
+			x = __builtin_popcount(lt); y = __builtin_popcount(gt);                    \
+			l += x; r1 += W-x-y; r2 += y; i += W;                                      \
+		}                                                                              \
+		else {                                                                         \
+			x = a[i] < pv; y = pv < a[i];                                              \
+			a[l] = a[i]; s1[r1] = a[i]; s2[r2] = a[i];                                 \
+			l += x; r1 += !(x | y); r2 += y; i++;                                      \
+		}                                                                              \
+		if(r1 == hLen || r2 == hLen) {                                                 \
+			t = r1 == hLen ? s1 : s2;                                                  \
+			rem = l % hLen;                                                            \
+			p = a+l - rem;                                                             \
+			                                                                           \
+			memcpy(p+hLen, p, rem * sizeof(T));                                        \
+			memcpy(p, t, hLen * sizeof(T));                                            \
+			                                                                           \
+			l += hLen;                                                                 \
+			if(t == s1) { r1 = 0; b1++; }                                              \
+			else        { r2 = 0; b2++; }                                              \
+		}                                                                              \
+	}                                                                                  \
+	g[0] = i; g[1] = l; g[2] = r1; g[3] = r2; g[4] = b1; g[5] = b2;                    \
+}
+
+#define LOG_READ_KERNEL(NAME, TARGET, T, VEC, W, LOADN, SPLAT, MASK) \
+__attribute__((target(TARGET)))                                      \
+static size_t NAME(const void *va, const void *vpiv, int wLen) {      \
+	const T *a = (const T*)va;                                        \
+	VEC vp = SPLAT(vpiv);                                             \
+	size_t r = 0;                                                     \
+	int k, c;                                                         \
+	                                                                  \
+	for(k = 0; k < wLen; k += W) {                                    \
+		c = wLen-k < W ? wLen-k : W;                                  \
+		VEC v = LOADN(a+k, c);                                        \
+		r |= (size_t)(MASK(v, vp) & ((1u << c) - 1)) << k;            \
+	}                                                                 \
+	return r;                                                         \
+}
+
+#define LOG_XOR_KERNEL(NAME, TARGET, T, VEC, W, LOADM, STOREM) \
+__attribute__((target(TARGET)))                               \
+static void NAME(void *va, void *vb, size_t v) {               \
+	T *a = (T*)va, *b = (T*)vb;                                \
+	unsigned m;                                                \
+	                                                           \
+	for(; v; v >>= W, a += W, b += W) {                        \
+		if(!(m = v & ((1u << W) - 1))) continue;               \
+		                                                       \
+		VEC x = LOADM(a, m), y = LOADM(b, m);                  \
+		STOREM(a, m, y); STOREM(b, m, x);                      \
+	}                                                          \
+}
+
+//////////////
+//          //
+//  AVX512  //
+//          //
+//////////////
+
+#define LOG_512 "avx512f"
+
+#define LOG_512_LOAD(p)    _mm512_loadu_si512(p)
+#define LOG_512_SPLAT32(p) _mm512_set1_epi32(log_bits32(p))
+#define LOG_512_SPLAT64(p) _mm512_set1_epi64(log_bits64(p))
+
+#define LOG_512_PS(v) _mm512_castsi512_ps(v)
+#define LOG_512_PD(v) _mm512_castsi512_pd(v)
+
+#define LOG_512_LT_I32(v, vp) _mm512_cmplt_epi32_mask(v, vp)
+#define LOG_512_LE_I32(v, vp) _mm512_cmple_epi32_mask(v, vp)
+#define LOG_512_LT_U32(v, vp) _mm512_cmplt_epu32_mask(v, vp)
+#define LOG_512_LE_U32(v, vp) _mm512_cmple_epu32_mask(v, vp)
+#define LOG_512_LT_F32(v, vp) _mm512_cmp_ps_mask(LOG_512_PS(v), LOG_512_PS(vp), _CMP_LT_OQ)
+#define LOG_512_LE_F32(v, vp) _mm512_cmp_ps_mask(LOG_512_PS(v), LOG_512_PS(vp), _CMP_LE_OQ)
+#define LOG_512_LT_I64(v, vp) _mm512_cmplt_epi64_mask(v, vp)
+#define LOG_512_LE_I64(v, vp) _mm512_cmple_epi64_mask(v, vp)
+#define LOG_512_LT_U64(v, vp) _mm512_cmplt_epu64_mask(v, vp)
+#define LOG_512_LE_U64(v, vp) _mm512_cmple_epu64_mask(v, vp)
+#define LOG_512_LT_F64(v, vp) _mm512_cmp_pd_mask(LOG_512_PD(v), LOG_512_PD(vp), _CMP_LT_OQ)
+#define LOG_512_LE_F64(v, vp) _mm512_cmp_pd_mask(LOG_512_PD(v), LOG_512_PD(vp), _CMP_LE_OQ)
+
+#define LOG_512_STORE32                                     \
+	_mm512_mask_compressstoreu_epi32(a+l, (__mmask16)m, v); \
+	_mm512_mask_compressstoreu_epi32(s+r, (__mmask16)~m, v)
+#define LOG_512_STORE64                                     \
+	_mm512_mask_compressstoreu_epi64(a+l, (__mmask8)m, v);  \
+	_mm512_mask_compressstoreu_epi64(s+r, (__mmask8)~m, v)
+
+#define LOG_512_GROUP32(KEY, T)                                                                    \
+	LOG_GROUP_KERNEL(log_group_512_lt_##KEY, LOG_512, T, __m512i, 16, LOG_512_LOAD, LOG_512_SPLAT32, \
+	                 LOG_512_LT_##KEY, LOG_512_STORE32, <)                                            \
+	LOG_GROUP_KERNEL(log_group_512_le_##KEY, LOG_512, T, __m512i, 16, LOG_512_LOAD, LOG_512_SPLAT32, \
+	                 LOG_512_LE_##KEY, LOG_512_STORE32, <=)
+#define LOG_512_GROUP64(KEY, T)                                                                    \
+	LOG_GROUP_KERNEL(log_group_512_lt_##KEY, LOG_512, T, __m512i, 8, LOG_512_LOAD, LOG_512_SPLAT64,  \
+	                 LOG_512_LT_##KEY, LOG_512_STORE64, <)                                            \
+	LOG_GROUP_KERNEL(log_group_512_le_##KEY, LOG_512, T, __m512i, 8, LOG_512_LOAD, LOG_512_SPLAT64,  \
+	                 LOG_512_LE_##KEY, LOG_512_STORE64, <=)
+
+#define LOG_512_PACK32(p, m, v) _mm512_mask_compressstoreu_epi32(p, (__mmask16)(m), v)
+#define LOG_512_PACK64(p, m, v) _mm512_mask_compressstoreu_epi64(p, (__mmask8)(m), v)
+
+#define LOG_512_GROUP3(KEY, T, W, BITS)                                                        \
+	LOG_GROUP3_KERNEL(log_group3_512_##KEY, LOG_512, T, __m512i, W, LOG_512_LOAD,              \
+	                  LOG_512_SPLAT##BITS, LOG_512_LT_##KEY, LOG_512_PACK##BITS)
+
+#define LOG_512_LOADN32(p, c)     _mm512_maskz_loadu_epi32((__mmask16)((1u << (c)) - 1), p)
+#define LOG_512_LOADN64(p, c)     _mm512_maskz_loadu_epi64((__mmask8)((1u << (c)) - 1), p)
+#define LOG_512_LOADM32(p, m)     _mm512_maskz_loadu_epi32((__mmask16)(m), p)
+#define LOG_512_LOADM64(p, m)     _mm512_maskz_loadu_epi64((__mmask8)(m), p)
+#define LOG_512_STOREM32(p, m, x) _mm512_mask_storeu_epi32(p, (__mmask16)(m), x)
+#define LOG_512_STOREM64(p, m, x) _mm512_mask_storeu_epi64(p, (__mmask8)(m), x)
+
+#define LOG_512_READ(KEY, T, W, BITS)                                                            \
+	LOG_READ_KERNEL(log_read_512_lt_##KEY, LOG_512, T, __m512i, W, LOG_512_LOADN##BITS,          \
+	                LOG_512_SPLAT##BITS, LOG_512_LT_##KEY)                                        \
+	LOG_READ_KERNEL(log_read_512_le_##KEY, LOG_512, T, __m512i, W, LOG_512_LOADN##BITS,          \
+	                LOG_512_SPLAT##BITS, LOG_512_LE_##KEY)
+
+LOG_512_GROUP32(I32, int32_t)
+LOG_512_GROUP32(U32, uint32_t)
+LOG_512_GROUP32(F32, float)
+LOG_512_GROUP64(I64, int64_t)
+LOG_512_GROUP64(U64, uint64_t)
+LOG_512_GROUP64(F64, double)
+
+LOG_512_GROUP3(I32, int32_t,  16, 32)
+LOG_512_GROUP3(U32, uint32_t, 16, 32)
+LOG_512_GROUP3(F32, float,    16, 32)
+LOG_512_GROUP3(I64, int64_t,  8,  64)
+LOG_512_GROUP3(U64, uint64_t, 8,  64)
+LOG_512_GROUP3(F64, double,   8,  64)
+
+LOG_512_READ(I32, int32_t,  16, 32)
+LOG_512_READ(U32, uint32_t, 16, 32)
+LOG_512_READ(F32, float,    16, 32)
+LOG_512_READ(I64, int64_t,  8,  64)
+LOG_512_READ(U64, uint64_t, 8,  64)
+LOG_512_READ(F64, double,   8,  64)
+
+LOG_XOR_KERNEL(log_xor_512_32, LOG_512, int32_t, __m512i, 16, LOG_512_LOADM32, LOG_512_STOREM32)
+LOG_XOR_KERNEL(log_xor_512_64, LOG_512, int64_t, __m512i, 8,  LOG_512_LOADM64, LOG_512_STOREM64)
+
+////////////
+//        //
+//  AVX2  //
+//        //
+////////////
+
+// AVX2 has no compress store: the left and right lanes are packed with a permutation
+// and stored as whole vectors.  The left store may overwrite a[l, i+W), which only holds
+// elements already moved or loaded, and the right store stays in s since r+W <= bLen
+
+#define LOG_256 "avx2,bmi2"
+
+__attribute__((target(LOG_256)))
+static inline __m256i log_256_pack(unsigned m) { // permutation moving the set lanes of m first
+	uint64_t e = _pdep_u64(m, 0x0101010101010101ull) * 0xFF;
+	
+	return _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(_pext_u64(0x0706050403020100ull, e)));
+}
+
+#define LOG_256_LOAD(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define LOG_256_SPLAT32(p) _mm256_set1_epi32(log_bits32(p))
+#define LOG_256_SPLAT64(p) _mm256_set1_epi64x(log_bits64(p))
+
+#define LOG_256_PS(v) _mm256_castsi256_ps(v)
+#define LOG_256_PD(v) _mm256_castsi256_pd(v)
+
+#define LOG_256_BIAS32(v) _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN))
+#define LOG_256_BIAS64(v) _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN))
+
+#define LOG_256_LT_I32(v, vp)  _mm256_movemask_ps(LOG_256_PS(_mm256_cmpgt_epi32(vp, v)))
+#define LOG_256_LE_I32(v, vp) (_mm256_movemask_ps(LOG_256_PS(_mm256_cmpgt_epi32(v, vp))) ^ 0xFF)
+#define LOG_256_LT_U32(v, vp)  LOG_256_LT_I32(LOG_256_BIAS32(v), LOG_256_BIAS32(vp))
+#define LOG_256_LE_U32(v, vp)  LOG_256_LE_I32(LOG_256_BIAS32(v), LOG_256_BIAS32(vp))
+#define LOG_256_LT_F32(v, vp)  _mm256_movemask_ps(_mm256_cmp_ps(LOG_256_PS(v), LOG_256_PS(vp), _CMP_LT_OQ))
+#define LOG_256_LE_F32(v, vp)  _mm256_movemask_ps(_mm256_cmp_ps(LOG_256_PS(v), LOG_256_PS(vp), _CMP_LE_OQ))
+#define LOG_256_LT_I64(v, vp)  _mm256_movemask_pd(LOG_256_PD(_mm256_cmpgt_epi64(vp, v)))
+#define LOG_256_LE_I64(v, vp) (_mm256_movemask_pd(LOG_256_PD(_mm256_cmpgt_epi64(v, vp))) ^ 0xF)
+#define LOG_256_LT_U64(v, vp)  LOG_256_LT_I64(LOG_256_BIAS64(v), LOG_256_BIAS64(vp))
+#define LOG_256_LE_U64(v, vp)  LOG_256_LE_I64(LOG_256_BIAS64(v), LOG_256_BIAS64(vp))
+#define LOG_256_LT_F64(v, vp)  _mm256_movemask_pd(_mm256_cmp_pd(LOG_256_PD(v), LOG_256_PD(vp), _CMP_LT_OQ))
+#define LOG_256_LE_F64(v, vp)  _mm256_movemask_pd(_mm256_cmp_pd(LOG_256_PD(v), LOG_256_PD(vp), _CMP_LE_OQ))
+
+#define LOG_256_STORE(m8)                                                                         \
+	_mm256_storeu_si256((__m256i*)(a+l), _mm256_permutevar8x32_epi32(v, log_256_pack(m8)));        \
+	_mm256_storeu_si256((__m256i*)(s+r), _mm256_permutevar8x32_epi32(v, log_256_pack((m8) ^ 0xFF)))
+
+#define LOG_256_STORE32 LOG_256_STORE(m)
+#define LOG_256_STORE64 LOG_256_STORE(_pdep_u32(m, 0x55) * 3)
+
+#define LOG_256_GROUP32(KEY, T)                                                                    \
+	LOG_GROUP_KERNEL(log_group_256_lt_##KEY, LOG_256, T, __m256i, 8, LOG_256_LOAD, LOG_256_SPLAT32,  \
+	                 LOG_256_LT_##KEY, LOG_256_STORE32, <)                                            \
+	LOG_GROUP_KERNEL(log_group_256_le_##KEY, LOG_256, T, __m256i, 8, LOG_256_LOAD, LOG_256_SPLAT32,  \
+	                 LOG_256_LE_##KEY, LOG_256_STORE32, <=)
+#define LOG_256_GROUP64(KEY, T)                                                                    \
+	LOG_GROUP_KERNEL(log_group_256_lt_##KEY, LOG_256, T, __m256i, 4, LOG_256_LOAD, LOG_256_SPLAT64,  \
+	                 LOG_256_LT_##KEY, LOG_256_STORE64, <)                                            \
+	LOG_GROUP_KERNEL(log_group_256_le_##KEY, LOG_256, T, __m256i, 4, LOG_256_LOAD, LOG_256_SPLAT64,  \
+	                 LOG_256_LE_##KEY, LOG_256_STORE64, <=)
+
+#define LOG_256_PACK32(p, m, v) \
+	_mm256_storeu_si256((__m256i*)(p), _mm256_permutevar8x32_epi32(v, log_256_pack(m)))
+#define LOG_256_PACK64(p, m, v) LOG_256_PACK32(p, _pdep_u32(m, 0x55) * 3, v)
+
+#define LOG_256_GROUP3(KEY, T, W, BITS)                                                        \
+	LOG_GROUP3_KERNEL(log_group3_256_##KEY, LOG_256, T, __m256i, W, LOG_256_LOAD,              \
+	                  LOG_256_SPLAT##BITS, LOG_256_LT_##KEY, LOG_256_PACK##BITS)
+
+// masks of the first c lanes / of the lanes set in m
+
+#define LOG_256_FIRST32(c) _mm256_cmpgt_epi32(_mm256_set1_epi32(c), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+#define LOG_256_FIRST64(c) _mm256_cmpgt_epi64(_mm256_set1_epi64x(c), _mm256_setr_epi64x(0, 1, 2, 3))
+
+#define LOG_256_BITS32(m) _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(m), LOG_256_SEL32), LOG_256_SEL32)
+#define LOG_256_BITS64(m) _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(m), LOG_256_SEL64), LOG_256_SEL64)
+#define LOG_256_SEL32 _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)
+#define LOG_256_SEL64 _mm256_setr_epi64x(1, 2, 4, 8)
+
+#define LOG_256_LOADN32(p, c)     _mm256_maskload_epi32((const int*)(p), LOG_256_FIRST32(c))
+#define LOG_256_LOADN64(p, c)     _mm256_maskload_epi64((const long long*)(p), LOG_256_FIRST64(c))
+#define LOG_256_LOADM32(p, m)     _mm256_maskload_epi32((const int*)(p), LOG_256_BITS32(m))
+#define LOG_256_LOADM64(p, m)     _mm256_maskload_epi64((const long long*)(p), LOG_256_BITS64(m))
+#define LOG_256_STOREM32(p, m, x) _mm256_maskstore_epi32((int*)(p), LOG_256_BITS32(m), x)
+#define LOG_256_STOREM64(p, m, x) _mm256_maskstore_epi64((long long*)(p), LOG_256_BITS64(m), x)
+
+#define LOG_256_READ(KEY, T, W, BITS)                                                            \
+	LOG_READ_KERNEL(log_read_256_lt_##KEY, LOG_256, T, __m256i, W, LOG_256_LOADN##BITS,          \
+	                LOG_256_SPLAT##BITS, LOG_256_LT_##KEY)                                        \
+	LOG_READ_KERNEL(log_read_256_le_##KEY, LOG_256, T, __m256i, W, LOG_256_LOADN##BITS,          \
+	                LOG_256_SPLAT##BITS, LOG_256_LE_##KEY)
+
+LOG_256_GROUP32(I32, int32_t)
+LOG_256_GROUP32(U32, uint32_t)
+LOG_256_GROUP32(F32, float)
+LOG_256_GROUP64(I64, int64_t)
+LOG_256_GROUP64(U64, uint64_t)
+LOG_256_GROUP64(F64, double)
+
+LOG_256_GROUP3(I32, int32_t,  8, 32)
+LOG_256_GROUP3(U32, uint32_t, 8, 32)
+LOG_256_GROUP3(F32, float,    8, 32)
+LOG_256_GROUP3(I64, int64_t,  4, 64)
+LOG_256_GROUP3(U64, uint64_t, 4, 64)
+LOG_256_GROUP3(F64, double,   4, 64)
+
+LOG_256_READ(I32, int32_t,  8, 32)
+LOG_256_READ(U32, uint32_t, 8, 32)
+LOG_256_READ(F32, float,    8, 32)
+LOG_256_READ(I64, int64_t,  4, 64)
+LOG_256_READ(U64, uint64_t, 4, 64)
+LOG_256_READ(F64, double,   4, 64)
+
+LOG_XOR_KERNEL(log_xor_256_32, LOG_256, int32_t, __m256i, 8, LOG_256_LOADM32, LOG_256_STOREM32)
+LOG_XOR_KERNEL(log_xor_256_64, LOG_256, int64_t, __m256i, 4, LOG_256_LOADM64, LOG_256_STOREM64)
+
+// sorting networks for up to R*W integer keys held in R vectors: a network sorts the
+// columns, a transpose turns them into sorted vectors, and bitonic merges combine those.
+// Padding lanes hold the maximum key.  Equal integer keys are indistinguishable, so the
+// result matches a stable sort; float keys are left to the scalar path (-0.0 == 0.0)
+
+#define LOG_256_CE(MIN, MAX, x, y) { __m256i t_ = MIN(x, y); y = MAX(x, y); x = t_; }
+
+#define LOG_256_MERGE(MIN, MAX, REV, CLEAN, r, R, K) {                              \
+	__m256i u_[2*K], b_;                                                            \
+	size_t i_, j_, d_;                                                              \
+                                                                                    \
+	for(i_ = 0; i_ < R; i_ += 2*K) {                                                \
+		_Pragma("GCC unroll 8")                                                     \
+		for(j_ = 0; j_ < K; j_++) {                                                 \
+			b_ = REV(r[i_+2*K-1-j_]);                                               \
+			u_[j_] = MIN(r[i_+j_], b_); u_[K+j_] = MAX(r[i_+j_], b_);               \
+		}                                                                           \
+		_Pragma("GCC unroll 8")                                                     \
+		for(d_ = K/2; d_; d_ /= 2)                                                  \
+			_Pragma("GCC unroll 8")                                                 \
+			for(j_ = 0; j_ < 2*K; j_++)                                             \
+				if(!(j_ & d_)) LOG_256_CE(MIN, MAX, u_[j_], u_[j_+d_]);             \
+                                                                                    \
+		_Pragma("GCC unroll 8")                                                     \
+		for(j_ = 0; j_ < 2*K; j_++) { CLEAN(MIN, MAX, u_[j_]); r[i_+j_] = u_[j_]; } \
+	}                                                                               \
+}
+
+// 8 x 8 lanes of 32 bits
+
+#define LOG_256_REV32(x) _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))
+
+#define LOG_256_CLEAN32(MIN, MAX, x) {                     \
+	__m256i y_ = _mm256_permute2x128_si256(x, x, 1);       \
+	x  = _mm256_blend_epi32(MIN(x, y_), MAX(x, y_), 0xF0); \
+	y_ = _mm256_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)); \
+	x  = _mm256_blend_epi32(MIN(x, y_), MAX(x, y_), 0xCC); \
+	y_ = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); \
+	x  = _mm256_blend_epi32(MIN(x, y_), MAX(x, y_), 0xAA); \
+}
+
+#define LOG_SORT_KERNEL32(NAME, MIN, MAX, TOP)                                  \
+__attribute__((target(LOG_256)))                                                \
+static void NAME(void *va, size_t n) {                                          \
+	int *a = (int*)va;                                                          \
+	__m256i r[8], t[8], m, top = _mm256_set1_epi32(TOP);                        \
+	size_t k;                                                                   \
+                                                                                \
+	for(k = 0; k < 8; k++) {                                                    \
+		m = LOG_256_FIRST32(n > 8*k ? (int)(n - 8*k) : 0);                      \
+		r[k] = _mm256_blendv_epi8(top, _mm256_maskload_epi32(a + 8*k, m), m);   \
+	}                                                                           \
+	LOG_256_CE(MIN, MAX, r[0], r[1]); LOG_256_CE(MIN, MAX, r[2], r[3]);         \
+	LOG_256_CE(MIN, MAX, r[4], r[5]); LOG_256_CE(MIN, MAX, r[6], r[7]);         \
+	LOG_256_CE(MIN, MAX, r[0], r[2]); LOG_256_CE(MIN, MAX, r[1], r[3]);         \
+	LOG_256_CE(MIN, MAX, r[4], r[6]); LOG_256_CE(MIN, MAX, r[5], r[7]);         \
+	LOG_256_CE(MIN, MAX, r[1], r[2]); LOG_256_CE(MIN, MAX, r[5], r[6]);         \
+	LOG_256_CE(MIN, MAX, r[0], r[4]); LOG_256_CE(MIN, MAX, r[1], r[5]);         \
+	LOG_256_CE(MIN, MAX, r[2], r[6]); LOG_256_CE(MIN, MAX, r[3], r[7]);         \
+	LOG_256_CE(MIN, MAX, r[2], r[4]); LOG_256_CE(MIN, MAX, r[3], r[5]);         \
+	LOG_256_CE(MIN, MAX, r[1], r[2]); LOG_256_CE(MIN, MAX, r[3], r[4]);         \
+	LOG_256_CE(MIN, MAX, r[5], r[6]);                                           \
+                                                                                \
+	for(k = 0; k < 8; k += 2) {                                                 \
+		t[k]   = _mm256_unpacklo_epi32(r[k], r[k+1]);                           \
+		t[k+1] = _mm256_unpackhi_epi32(r[k], r[k+1]);                           \
+	}                                                                           \
+	for(k = 0; k < 8; k += 4) {                                                 \
+		r[k]   = _mm256_unpacklo_epi64(t[k],   t[k+2]);                         \
+		r[k+1] = _mm256_unpackhi_epi64(t[k],   t[k+2]);                         \
+		r[k+2] = _mm256_unpacklo_epi64(t[k+1], t[k+3]);                         \
+		r[k+3] = _mm256_unpackhi_epi64(t[k+1], t[k+3]);                         \
+	}                                                                           \
+	for(k = 0; k < 4; k++) {                                                    \
+		t[k]   = _mm256_permute2x128_si256(r[k], r[k+4], 0x20);                 \
+		t[k+4] = _mm256_permute2x128_si256(r[k], r[k+4], 0x31);                 \
+	}                                                                           \
+	LOG_256_MERGE(MIN, MAX, LOG_256_REV32, LOG_256_CLEAN32, t, 8, 1)            \
+	LOG_256_MERGE(MIN, MAX, LOG_256_REV32, LOG_256_CLEAN32, t, 8, 2)            \
+	LOG_256_MERGE(MIN, MAX, LOG_256_REV32, LOG_256_CLEAN32, t, 8, 4)            \
+                                                                                \
+	for(k = 0; k < 8 && 8*k < n; k++)                                           \
+		_mm256_maskstore_epi32(a + 8*k, LOG_256_FIRST32((int)(n - 8*k)), t[k]); \
+}
+
+LOG_SORT_KERNEL32(log_sort_256_I32, _mm256_min_epi32, _mm256_max_epi32, INT32_MAX)
+LOG_SORT_KERNEL32(log_sort_256_U32, _mm256_min_epu32, _mm256_max_epu32, -1)
+
+// batched: one segment per lane.  The segments are transposed into LOG_BATCH_LEN vectors
+// padded with the maximum key, an odd-even merge network on whole vectors sorts every
+// lane at once, and the lanes are copied back
+
+#define LOG_BATCH_KERNEL32(NAME, MIN, MAX, TOP)                                          \
+__attribute__((target(LOG_256)))                                                         \
+static void NAME(void *va, const size_t *off, size_t c) {                                \
+	int *a = (int*)va, t[LOG_BATCH_LEN][8];                                              \
+	__m256i r[LOG_BATCH_LEN];                                                            \
+	size_t i, j, k, p, n;                                                                \
+                                                                                         \
+	for(k = 0; k < LOG_BATCH_LEN; k++)                                                   \
+		for(j = 0; j < 8; j++) t[k][j] = (int)(TOP);                                     \
+                                                                                         \
+	for(j = 0; j < c; j++)                                                               \
+		for(k = 0, n = off[j+1]-off[j]; k < n; k++) t[k][j] = a[off[j]+k];              \
+                                                                                         \
+	_Pragma("GCC unroll 16")                                                             \
+	for(k = 0; k < LOG_BATCH_LEN; k++) r[k] = _mm256_loadu_si256((__m256i*)t[k]);       \
+	_Pragma("GCC unroll 4")                                                              \
+	for(p = 1; p < LOG_BATCH_LEN; p *= 2)                                                \
+		_Pragma("GCC unroll 4")                                                          \
+		for(k = p; k; k /= 2)                                                            \
+			_Pragma("GCC unroll 16")                                                     \
+			for(j = k % p; j+k < LOG_BATCH_LEN; j += 2*k)                                \
+				_Pragma("GCC unroll 8")                                                  \
+				for(i = 0; i < k; i++)                                                   \
+					if((i+j) / (2*p) == (i+j+k) / (2*p)) LOG_256_CE(MIN, MAX, r[i+j], r[i+j+k]); \
+                                                                                         \
+	_Pragma("GCC unroll 16")                                                             \
+	for(k = 0; k < LOG_BATCH_LEN; k++) _mm256_storeu_si256((__m256i*)t[k], r[k]);       \
+                                                                                         \
+	for(j = 0; j < c; j++)                                                               \
+		for(k = 0, n = off[j+1]-off[j]; k < n; k++) a[off[j]+k] = t[k][j];              \
+}
+
+LOG_BATCH_KERNEL32(log_batch_256_I32, _mm256_min_epi32, _mm256_max_epi32, INT32_MAX)
+LOG_BATCH_KERNEL32(log_batch_256_U32, _mm256_min_epu32, _mm256_max_epu32, -1)
+
+////////////////
+//            //
+//  DISPATCH  //
+//            //
+////////////////
+
+#define LOG_KERNELS(ISA, NAME) {                         \
+	{ NAME##_##ISA##_lt_I32, NAME##_##ISA##_le_I32 },    \
+	{ NAME##_##ISA##_lt_U32, NAME##_##ISA##_le_U32 },    \
+	{ NAME##_##ISA##_lt_F32, NAME##_##ISA##_le_F32 },    \
+	{ NAME##_##ISA##_lt_I64, NAME##_##ISA##_le_I64 },    \
+	{ NAME##_##ISA##_lt_U64, NAME##_##ISA##_le_U64 },    \
+	{ NAME##_##ISA##_lt_F64, NAME##_##ISA##_le_F64 } }
+
+static inline log_group_fn log_simd_group(int key, int op) {
+	static const log_group_fn k512[6][2] = LOG_KERNELS(512, log_group);
+	static const log_group_fn k256[6][2] = LOG_KERNELS(256, log_group);
+	
+	if(key < LOG_KEY_I32 || key > LOG_KEY_F64) return NULL;
+	
+	switch(log_simd_level()) {
+		case 2:  return k512[key-1][op];
+		case 1:  return k256[key-1][op];
+		default: return NULL;
+	}
+}
+static inline log_group3_fn log_simd_group3(int key) {
+	static const log_group3_fn k512[6] = { log_group3_512_I32, log_group3_512_U32, log_group3_512_F32,
+	                                       log_group3_512_I64, log_group3_512_U64, log_group3_512_F64 };
+	static const log_group3_fn k256[6] = { log_group3_256_I32, log_group3_256_U32, log_group3_256_F32,
+	                                       log_group3_256_I64, log_group3_256_U64, log_group3_256_F64 };
+	
+	if(key < LOG_KEY_I32 || key > LOG_KEY_F64) return NULL;
+	
+	switch(log_simd_level()) {
+		case 2:  return k512[key-1];
+		case 1:  return k256[key-1];
+		default: return NULL;
+	}
+}
+static inline log_read_fn log_simd_read(int key, int op) {
+	static const log_read_fn k512[6][2] = LOG_KERNELS(512, log_read);
+	static const log_read_fn k256[6][2] = LOG_KERNELS(256, log_read);
+	
+	if(key < LOG_KEY_I32 || key > LOG_KEY_F64) return NULL;
+	
+	switch(log_simd_level()) {
+		case 2:  return k512[key-1][op];
+		case 1:  return k256[key-1][op];
+		default: return NULL;
+	}
+}
+static inline log_xor_fn log_simd_xor(int key) {
+	if(key < LOG_KEY_I32 || key > LOG_KEY_F64) return NULL;
+	
+	char wide = key >= LOG_KEY_I64;
+	
+	switch(log_simd_level()) {
+		case 2:  return wide ? log_xor_512_64 : log_xor_512_32;
+		case 1:  return wide ? log_xor_256_64 : log_xor_256_32;
+		default: return NULL;
+	}
+}
+static inline log_sort_fn log_simd_sort(int key, size_t n) {
+	if(!log_simd_level() || n > 64) return NULL;
+	
+	switch(key) {
+		case LOG_KEY_I32: return log_sort_256_I32;
+		case LOG_KEY_U32: return log_sort_256_U32;
+		default:          return NULL;
+	}
+}
+static inline log_batch_fn log_simd_batch(int key) {
+	if(!log_simd_level()) return NULL;
+	
+	switch(key) {
+		case LOG_KEY_I32: return log_batch_256_I32;
+		case LOG_KEY_U32: return log_batch_256_U32;
+		default:          return NULL;
+	}
+}
+
+#else
+
+static inline log_group_fn  log_simd_group(int key, int op)  { return NULL; }
+static inline log_group3_fn log_simd_group3(int key)         { return NULL; }
+static inline log_read_fn   log_simd_read(int key, int op)   { return NULL; }
+static inline log_xor_fn    log_simd_xor(int key)            { return NULL; }
+static inline log_sort_fn   log_simd_sort(int key, size_t n) { return NULL; }
+static inline log_batch_fn  log_simd_batch(int key)          { return NULL; }
+
+#endif // LOG_SIMD
+
+#endif // LOGSIMD_H
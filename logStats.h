@@ -0,0 +1,160 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGSTATS_H
+#define LOGSTATS_H
+
+// opt-in instrumentation: define LOGSORT_STATS before including logsort.h to count, per
+// phase and per recursion depth of logsort_rec, comparisons, element moves (copies made
+// one element at a time), bytes passed to memcpy/memmove and timestamp ticks.  Without it
+// the hooks in logsort.h expand to nothing.
+//
+// Vectorised kernels count one comparison and the element stores per element they test;
+// the vectorised small sort counts its time only.  The counters belong to the translation
+// unit and are not synchronised, so read them after single-threaded sorts.  Partition
+// quality is recorded per depth as the number of partitions, their elements and the sum
+// of their larger parts, so larger/elems near 1/2 means good pivots.
+
+#include <string.h>
+#include <time.h>
+
+enum {
+	LOG_PH_OTHER,   // entry points and bookkeeping
+	LOG_PH_RUNS,    // natural run detection
+	LOG_PH_PIVOT,   // pivot selection
+	LOG_PH_GROUP,   // grouping pass of the partition
+	LOG_PH_ENCODE,  // encoding tag bits in block pairs
+	LOG_PH_SWAP,    // block swapping of the larger partition
+	LOG_PH_CYCLE,   // block cycle sort
+	LOG_PH_CLEANUP, // shifting the leftover fragment
+	LOG_PH_LEAF,    // piposort of small subarrays
+	LOG_PH_MERGE,   // merging runs or the merge sort fallback
+	LOG_PHASES
+};
+
+#define LOG_STATS_DEPTH 64
+
+typedef struct {
+	unsigned long long cmp, moves, bytes, ticks;
+} log_counter;
+
+typedef struct {
+	log_counter phase[LOG_PHASES];
+	log_counter depth[LOG_STATS_DEPTH];
+	unsigned long long parts[LOG_STATS_DEPTH], elems[LOG_STATS_DEPTH], larger[LOG_STATS_DEPTH];
+	
+	unsigned long long t; // time of the last phase change
+	int cur;              // current phase
+	size_t level;         // current depth
+} log_stats;
+
+static log_stats log_stats_data;
+
+static inline unsigned long long log_stats_now(void) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_ia32_rdtsc();
+#else
+	return (unsigned long long)clock();
+#endif
+}
+
+static inline log_counter *log_stats_depth(void) {
+	size_t d = log_stats_data.level;
+	return log_stats_data.depth + (d < LOG_STATS_DEPTH ? d : LOG_STATS_DEPTH-1);
+}
+
+// charges the time since the last change to the current phase and depth
+
+static inline void log_stats_flush(void) {
+	unsigned long long t = log_stats_now(), d = t - log_stats_data.t;
+	
+	log_stats_data.phase[log_stats_data.cur].ticks += d;
+	log_stats_depth()->ticks += d;
+	log_stats_data.t = t;
+}
+static inline int log_stats_phase(int p) {
+	int q = log_stats_data.cur;
+	
+	log_stats_flush();
+	log_stats_data.cur = p;
+	
+	return q;
+}
+static inline void log_stats_level(size_t d) {
+	log_stats_flush();
+	log_stats_data.level = d;
+}
+
+static inline void log_stats_cmp(unsigned long long k) {
+	log_stats_data.phase[log_stats_data.cur].cmp += k;
+	log_stats_depth()->cmp += k;
+}
+static inline void log_stats_moves(unsigned long long k) {
+	log_stats_data.phase[log_stats_data.cur].moves += k;
+	log_stats_depth()->moves += k;
+}
+static inline void log_stats_bytes(unsigned long long k) {
+	log_stats_data.phase[log_stats_data.cur].bytes += k;
+	log_stats_depth()->bytes += k;
+}
+
+// records a partition of n elements whose larger part has m at the current depth
+
+static inline void log_stats_part(size_t n, size_t m) {
+	size_t d = log_stats_data.level < LOG_STATS_DEPTH ? log_stats_data.level : LOG_STATS_DEPTH-1;
+	
+	log_stats_data.parts[d]++;
+	log_stats_data.elems[d] += n;
+	log_stats_data.larger[d] += m;
+}
+
+static inline size_t log_stats_popcount(size_t v) {
+	size_t c = 0;
+	
+	for(; v; v &= v-1) c++;
+	return c;
+}
+
+static inline void log_stats_reset(void) {
+	memset(&log_stats_data, 0, sizeof(log_stats));
+	log_stats_data.t = log_stats_now();
+}
+static inline const log_stats *log_stats_get(void) {
+	log_stats_flush();
+	return &log_stats_data;
+}
+
+// comparisons of all phases since the last reset
+
+static inline unsigned long long log_stats_cmps(void) {
+	unsigned long long c = 0;
+	int p;
+	
+	for(p = 0; p < LOG_PHASES; p++) c += log_stats_data.phase[p].cmp;
+	return c;
+}
+
+#endif // LOGSTATS_H
@@ -0,0 +1,169 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGSTRING_H
+#define LOGSTRING_H
+
+// string sorting with cached key prefixes: logsort_strings sorts NUL-terminated strings
+// like strcmp and logsort_strviews (pointer, length) keys like memcmp, shorter first on
+// ties.  Each string gets a tag caching 7 bytes from the current depth, so the sort
+// compares integers in place instead of chasing pointers.  As in multikey quicksort, runs
+// of tags with equal prefixes continue with the next 7 bytes, so bytes known to be equal
+// are never compared again and each string is dereferenced once per level.
+//
+// The tags take O(n) memory; without it the strings are sorted by comparisons in place.
+// Like logsort.h, include it in one translation unit only.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	const char *p;
+	size_t len;
+} log_strview;
+
+typedef struct {
+	uint64_t pre; // 7 bytes from the depth, then how many of them the key has, 8 if more
+	const char *p;
+	size_t len;   // LOG_CSTR if NUL-terminated
+} log_strtag;
+
+typedef const char *log_cstr;
+
+#define LOG_CSTR ((size_t)-1)
+
+static inline int log_strview_cmp(const log_strview *a, const log_strview *b) {
+	int c = memcmp(a->p, b->p, a->len < b->len ? a->len : b->len);
+	return c ? c : (a->len > b->len) - (a->len < b->len);
+}
+
+#define LOGSORT_PREFIX log_strtag
+#define VAR log_strtag
+#define CMP(a, b) ((a)->pre > (b)->pre)
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+
+// fallbacks without memory for the tags
+
+#define LOGSORT_PREFIX log_cstr
+#define VAR log_cstr
+#define CMP(a, b) (strcmp(*(a), *(b)))
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+
+#define LOGSORT_PREFIX log_strview
+#define VAR log_strview
+#define CMP(a, b) (log_strview_cmp((a), (b)))
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+
+// the bytes [d, d+7) of a key whose first d bytes are known to be equal in its run: as an
+// integer, the tag orders like the keys with shorter keys first
+
+static inline uint64_t log_str_prefix(const char *p, size_t len, size_t d) {
+	const unsigned char *u = (const unsigned char*)p + d;
+	uint64_t k = 0;
+	size_t i, r = len - d;
+	
+	if(len == LOG_CSTR) {
+		for(i = 0; i < 7 && u[i]; i++) k |= (uint64_t)u[i] << (56 - 8*i);
+		
+		return k | (i < 7 ? i : u[7] ? 8 : 7);
+	}
+	for(i = 0; i < 7 && i < r; i++) k |= (uint64_t)u[i] << (56 - 8*i);
+	
+	return k | (r > 7 ? 8 : r);
+}
+
+// sorts tags whose keys agree on their first d bytes.  Runs of equal continuing prefixes
+// are sorted from d+7 on, recursing into all but the largest, so the stack is O(log n)
+
+void log_str_rec(log_strtag *t, log_strtag *s, size_t n, size_t bLen, size_t d) {
+	while(n > 1) {
+		size_t i, j, big = 0, bigLen = 0;
+		
+		for(i = 0; i < n; i++) t[i].pre = log_str_prefix(t[i].p, t[i].len, d);
+		
+		log_strtag_logsort_scratch(t, n, s, bLen);
+		d += 7;
+		
+		for(i = 0; i < n; i = j) {
+			for(j = i+1; j < n && t[j].pre == t[i].pre; j++) {}
+			
+			if(j-i < 2 || (t[i].pre & 0xFF) != 8) continue; // unique or ended
+			
+			if(j-i > bigLen) {
+				if(bigLen) log_str_rec(t+big, s, bigLen, bLen, d);
+				big = i; bigLen = j-i;
+			}
+			else log_str_rec(t+i, s, j-i, bLen, d);
+		}
+		t += big; n = bigLen;
+	}
+}
+
+// sorts the keys of c or v through tags, returns 0 without memory
+
+int log_str_sort(log_cstr *c, log_strview *v, size_t n) {
+	size_t bLen = log_auto_blen(sizeof(log_strtag), n), i;
+	log_strtag *t = (log_strtag*)malloc(n * sizeof(log_strtag));
+	
+	if(!t) return 0;
+	
+	log_strtag *s = (log_strtag*)malloc(bLen * sizeof(log_strtag));
+	if(!s) bLen = 0; // stack buffer
+	
+	for(i = 0; i < n; i++) {
+		t[i].p   = c ? c[i] : v[i].p;
+		t[i].len = c ? LOG_CSTR : v[i].len;
+	}
+	log_str_rec(t, s, n, bLen, 0);
+	
+	for(i = 0; i < n; i++) {
+		if(c) c[i] = t[i].p;
+		else { v[i].p = t[i].p; v[i].len = t[i].len; }
+	}
+	free(s);
+	free(t);
+	
+	return 1;
+}
+
+void logsort_strings(const char **a, size_t n) {
+	if(n > 1 && !log_str_sort(a, NULL, n)) log_cstr_logsort(a, n, LOGSORT_AUTO);
+}
+void logsort_strviews(log_strview *a, size_t n) {
+	if(n > 1 && !log_str_sort(NULL, a, n)) log_strview_logsort(a, n, LOGSORT_AUTO);
+}
+
+#endif // LOGSTRING_H
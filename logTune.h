@@ -0,0 +1,116 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGTUNE_H
+#define LOGTUNE_H
+
+// buffer length selection: pass LOGSORT_AUTO as bLen to derive it from the L1 data cache
+// and the element size.  Block moves copy bLen elements while tags cost O(log n) per
+// block, and on random keys the best bLen shrank with the square root of the element
+// size: about 512 ints, 128 64-byte and 64 256-byte records with a 48K L1.
+//
+// logsort_calibrate() times candidate lengths on sample data instead.  Its result can be
+// saved and restored with log_set_tuned_blen(); the setting is per translation unit.
+
+#include <stddef.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <unistd.h>
+#endif
+
+#define LOGSORT_AUTO 0
+
+#define LOG_DEFAULT_L1 32768
+#define LOG_DEFAULT_L2 (1 << 20)
+
+// data cache size of level 1 or 2 in bytes, detected once
+
+static inline size_t log_cache_size(int level) {
+	static long size[2] = {-1, -1};
+	long *c = size + (level > 1);
+	
+	if(*c < 0) {
+		*c = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+		*c = sysconf(level > 1 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL1_DCACHE_SIZE);
+#endif
+		if(*c <= 0) *c = level > 1 ? LOG_DEFAULT_L2 : LOG_DEFAULT_L1;
+	}
+	return *c;
+}
+
+// calibrated buffer lengths by element size, 0 if not calibrated
+
+#define LOG_TUNED_SIZES 16
+
+static size_t log_tuned_size[LOG_TUNED_SIZES], log_tuned_blen[LOG_TUNED_SIZES];
+
+static inline void log_set_tuned_blen(size_t size, size_t bLen) {
+	size_t i;
+	
+	for(i = 0; i < LOG_TUNED_SIZES; i++) {
+		if(!log_tuned_size[i] || log_tuned_size[i] == size) {
+			log_tuned_size[i] = size;
+			log_tuned_blen[i] = bLen;
+			return;
+		}
+	}
+}
+static inline size_t log_tuned(size_t size) {
+	size_t i;
+	
+	for(i = 0; i < LOG_TUNED_SIZES && log_tuned_size[i]; i++)
+		if(log_tuned_size[i] == size) return log_tuned_blen[i];
+	
+	return 0;
+}
+
+// smallest buffer whose blocks hold the tags of an n element partition
+
+static inline size_t log_min_blen(size_t n) {
+	size_t b = 9, w;
+	
+	for(;;) {
+		for(w = 0; ((size_t)1 << w) < n / (2*b); w++) {}
+		if(w < b) return b;
+		b++;
+	}
+}
+
+static inline size_t log_auto_blen(size_t size, size_t n) {
+	size_t r = 1, b = log_tuned(size), min = log_min_blen(n);
+	
+	if(!b) {
+		while((r+1)*(r+1) <= size) r++; // integer square root
+		b = log_cache_size(1) / (48*r);
+	}
+	if(b < min) b = min;
+	if(b > n)   b = n;
+	
+	return b;
+}
+
+#endif // LOGTUNE_H
@@ -24,18 +24,177 @@ SOFTWARE.
  *
  */
  
-#ifndef LOGSORT_H
-#define LOGSORT_H
+// logsort.h is a template: define VAR (element type) and CMP (comparison) before including.
+// CMP(a, b) is only ever tested as > 0 or <= 0 and may be a macro, in which case it is
+// inlined; its arguments are evaluated once per call site but may appear twice in a macro.
+//
+// There is no include guard so the header can be instantiated more than once per TU:
+// define LOGSORT_PREFIX to prefix every generated function, e.g. with LOGSORT_PREFIX int32
+// logsort() becomes int32_logsort().  See logsort.hpp for the C++ template front end.
+//
+// Sorting takes O(n log n) expected time.  Inputs defeating the pivot samples fall back to a
+// merge sort with O(n log n) comparisons but O(n log^2 n) moves, the worst case.
+//
+// Pass LOGSORT_AUTO as bLen to size the buffer from the cache and element size (logTune.h).
+// Define LOGSORT_STATS to count comparisons, moves and time per phase (logStats.h).
+// Define LOGSORT_MIN_CMP for expensive comparisons: block partitions cache the block types
+// and destinations in the buffer instead of re-comparing tag elements, so each element is
+// compared with the pivot about once per partition.
+//
+// If VAR is a primitive key sorted ascending, define LOGSORT_KEY as its LOG_KEY_* kind
+// (see logSimd.h) to enable the vectorised kernels.
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+#include "logSimd.h"
+#include "logTune.h"
+#include "logStats.h"
+
+#ifdef LOGSORT_PREFIX
+	#define LOG_CONCAT_(A, B) A##_##B
+	#define LOG_CONCAT(A, B) LOG_CONCAT_(A, B)
+	#define LOG_NAME(NAME) LOG_CONCAT(LOGSORT_PREFIX, NAME)
+	
+	#define log_counted_cmp          LOG_NAME(log_counted_cmp)
+	#define log_ceil_log             LOG_NAME(log_ceil_log)
+	#define log_smallsort            LOG_NAME(log_smallsort)
+	#define log_parity_merge         LOG_NAME(log_parity_merge)
+	#define log_piposort             LOG_NAME(log_piposort)
+	#define log_trim_four            LOG_NAME(log_trim_four)
+	#define log_median_of_nine       LOG_NAME(log_median_of_nine)
+	#define log_smart_median         LOG_NAME(log_smart_median)
+	#define log_block_xor            LOG_NAME(log_block_xor)
+	#define log_reverse              LOG_NAME(log_reverse)
+	#define log_rotate               LOG_NAME(log_rotate)
+	#define log_reverse_parallel     LOG_NAME(log_reverse_parallel)
+	#define log_rotate_parallel      LOG_NAME(log_rotate_parallel)
+	#define log_block_read_less      LOG_NAME(log_block_read_less)
+	#define log_block_read_less_eq   LOG_NAME(log_block_read_less_eq)
+	#define log_partition_easy_less    LOG_NAME(log_partition_easy_less)
+	#define log_partition_easy_less_eq LOG_NAME(log_partition_easy_less_eq)
+	#define log_block_partition_less    LOG_NAME(log_block_partition_less)
+	#define log_block_partition_less_eq LOG_NAME(log_block_partition_less_eq)
+	#define log_block_partition_cached_less    LOG_NAME(log_block_partition_cached_less)
+	#define log_block_partition_cached_less_eq LOG_NAME(log_block_partition_cached_less_eq)
+	#define log_partition_less       LOG_NAME(log_partition_less)
+	#define log_partition_less_eq    LOG_NAME(log_partition_less_eq)
+	#define log_partition_parallel_less    LOG_NAME(log_partition_parallel_less)
+	#define log_partition_parallel_less_eq LOG_NAME(log_partition_parallel_less_eq)
+	#define log_block_class          LOG_NAME(log_block_class)
+	#define log_block_read_three     LOG_NAME(log_block_read_three)
+	#define log_block_rotate         LOG_NAME(log_block_rotate)
+	#define log_block_partition_three LOG_NAME(log_block_partition_three)
+	#define log_partition_three_easy LOG_NAME(log_partition_three_easy)
+	#define log_partition_three      LOG_NAME(log_partition_three)
+	#define log_lower_bound          LOG_NAME(log_lower_bound)
+	#define log_upper_bound          LOG_NAME(log_upper_bound)
+	#define log_merge                LOG_NAME(log_merge)
+	#define log_merge_sort           LOG_NAME(log_merge_sort)
+	#define log_pivot_partition      LOG_NAME(log_pivot_partition)
+	#define logsort_rec              LOG_NAME(logsort_rec)
+	#define logsort                  LOG_NAME(logsort)
+	#define log_sort_segments        LOG_NAME(log_sort_segments)
+	#define log_segments_blen        LOG_NAME(log_segments_blen)
+	#define logsort_segmented        LOG_NAME(logsort_segmented)
+	#define logsort_scratch          LOG_NAME(logsort_scratch)
+	#define log_run_end              LOG_NAME(log_run_end)
+	#define log_push_run             LOG_NAME(log_push_run)
+	#define log_sort_runs            LOG_NAME(log_sort_runs)
+	#define logsort_rec_range        LOG_NAME(logsort_rec_range)
+	#define logsort_range_scratch    LOG_NAME(logsort_range_scratch)
+	#define logsort_range            LOG_NAME(logsort_range)
+	#define logsort_select           LOG_NAME(logsort_select)
+	#define logsort_partial          LOG_NAME(logsort_partial)
+	#define logsort_topk             LOG_NAME(logsort_topk)
+	#define logsort_calibrate        LOG_NAME(logsort_calibrate)
+	#define logmerge                 LOG_NAME(logmerge)
+	#define logmerge_append          LOG_NAME(logmerge_append)
+	#define log_apply_order          LOG_NAME(log_apply_order)
+	#define log_apply_index          LOG_NAME(log_apply_index)
+	#define log_block_read_pred      LOG_NAME(log_block_read_pred)
+	#define log_partition_easy_pred  LOG_NAME(log_partition_easy_pred)
+	#define log_block_partition_pred LOG_NAME(log_block_partition_pred)
+	#define log_block_partition_cached_pred LOG_NAME(log_block_partition_cached_pred)
+	#define log_partition_pred       LOG_NAME(log_partition_pred)
+	#define log_partition_parallel_pred LOG_NAME(log_partition_parallel_pred)
+	#define log_predicate            LOG_NAME(log_predicate)
+	#define log_stable_partition_buf LOG_NAME(log_stable_partition_buf)
+	#define log_stable_partition     LOG_NAME(log_stable_partition)
+	#define log_radix_key            LOG_NAME(log_radix_key)
+	#define log_radix_pivot          LOG_NAME(log_radix_pivot)
+	#define log_block_read_bit       LOG_NAME(log_block_read_bit)
+	#define log_partition_easy_bit   LOG_NAME(log_partition_easy_bit)
+	#define log_block_partition_bit  LOG_NAME(log_block_partition_bit)
+	#define log_block_partition_cached_bit  LOG_NAME(log_block_partition_cached_bit)
+	#define log_partition_bit        LOG_NAME(log_partition_bit)
+	#define log_partition_parallel_bit LOG_NAME(log_partition_parallel_bit)
+	#define log_radix_diff           LOG_NAME(log_radix_diff)
+	#define logsort_radix_rec        LOG_NAME(logsort_radix_rec)
+	#define logsort_radix_scratch    LOG_NAME(logsort_radix_scratch)
+	#define logsort_radix            LOG_NAME(logsort_radix)
+	#define log_ext_merge            LOG_NAME(log_ext_merge)
+	#define logsort_file             LOG_NAME(logsort_file)
+	#define logsort_rec_parallel     LOG_NAME(logsort_rec_parallel)
+	#define logsort_parallel         LOG_NAME(logsort_parallel)
+	#define logsort_segmented_parallel LOG_NAME(logsort_segmented_parallel)
+#endif
 
 #define MIN_SMALLSORT 7
 #define MIN_PIPOSORT 512
+#define MIN_RUN 32
+#define MIN_PARALLEL 65536
+#define MAX_PARALLEL_CHUNKS 64
+#define PARALLEL_SEGMENTS 256
+#define MAX_STACK_BYTES 1024
+#define STACK_LEN (MAX_STACK_BYTES / sizeof(VAR) > 9 ? MAX_STACK_BYTES / sizeof(VAR) : 9)
+
+// instrumentation hooks, see logStats.h.  ENTER switches to a phase and LEAVE restores the
+// phase and depth of the caller.  With stats, CMP, memcpy and memmove are wrapped to count
+// until the end of the header
+
+#ifdef LOGSORT_STATS
+	#define LOG_STAT_ENTER(p)  int log_prev_phase = log_stats_phase(p); size_t log_prev_level = log_stats_data.level
+	#define LOG_STAT_LEAVE()   (log_stats_level(log_prev_level), log_stats_phase(log_prev_phase))
+	#define LOG_STAT_SET(p)    log_stats_phase(p)
+	#define LOG_STAT_CMP(k)    log_stats_cmp(k)
+	#define LOG_STAT_MOVES(k)  log_stats_moves(k)
+	#define LOG_STAT_BYTES(k)  log_stats_bytes(k)
+	#define LOG_STAT_PART(n, m) (log_stats_part(n, m), log_stats_level(log_stats_data.level + 1))
+	
+	int log_counted_cmp(VAR *a, VAR *b) {
+		log_stats_cmp(1);
+		return CMP(a, b) > 0;
+	}
+	
+	#pragma push_macro("CMP")
+	#pragma push_macro("memcpy")
+	#pragma push_macro("memmove")
+	#undef CMP
+	#undef memcpy
+	#undef memmove
+	#define CMP(a, b) log_counted_cmp((a), (b))
+	#define memcpy(d, s, n)  (log_stats_bytes(n), memcpy(d, s, n))
+	#define memmove(d, s, n) (log_stats_bytes(n), memmove(d, s, n))
+#else
+	#define LOG_STAT_ENTER(p)
+	#define LOG_STAT_LEAVE()
+	#define LOG_STAT_SET(p)
+	#define LOG_STAT_CMP(k)
+	#define LOG_STAT_MOVES(k)
+	#define LOG_STAT_BYTES(k)
+	#define LOG_STAT_PART(n, m)
+#endif
 
 char log_ceil_log(size_t n) {
 	char r = 0;
-	while((1 << r) < n) r++;
+	while(((size_t)1 << r) < n) r++;
 	return r;
 }
 
@@ -96,6 +255,7 @@ void log_parity_merge(VAR *from, VAR *dest, size_t left, size_t right) {
 	VAR *ptl, *ptr, *tpl, *tpr, *tpd, *ptd;
 	unsigned char x;
 
+	LOG_STAT_MOVES(left+right);
 	ptl = from; ptr = from + left; ptd = dest;
 	tpl = from + left-1; tpr = from + left+right-1; tpd = dest + left+right-1;
 
@@ -111,6 +271,14 @@ void log_parity_merge(VAR *from, VAR *dest, size_t left, size_t right) {
 void log_piposort(VAR *array, VAR *swap, size_t n) {
 	size_t q1, q2, q3, q4, h1, h2;
 
+#ifdef LOGSORT_KEY
+	log_sort_fn sort = log_simd_sort(LOGSORT_KEY, n);
+	
+	if(sort) {
+		sort(array, n);
+		return;
+	}
+#endif
 	if(n <= MIN_SMALLSORT) {
 		log_smallsort(array, n);
 		return;
@@ -152,18 +320,21 @@ void log_trim_four(VAR *pta) {
 	x = (CMP(pta, pta + 2)  > 0) * 2; pta[0] = pta[x];
 }
 
-VAR log_median_of_nine(VAR *a, VAR *s, size_t n) {
+// pivot selection sorts a sample in the swap space and returns its median there
+
+VAR *log_median_of_nine(VAR *a, VAR *s, size_t n) {
 	size_t step = (n-1) / 8, i;
 	VAR *pa = a;
 	
 	for(i = 0; i < 9; i++) 
 		{ s[i] = *pa; pa += step; }
+	LOG_STAT_MOVES(9);
 	
 	log_smallsort(s, 9);
-	return s[4];
+	return s+4;
 }
 
-VAR log_smart_median(VAR *array, VAR *swap, size_t n, size_t bLen) {
+VAR *log_smart_median(VAR *array, VAR *swap, size_t n, size_t bLen) {
 	if(bLen < 64) return log_median_of_nine(array, swap, n);
 	
 	size_t cbrt;
@@ -177,6 +348,7 @@ VAR log_smart_median(VAR *array, VAR *swap, size_t n, size_t bLen) {
 	
 	for(c = 0; c < div; c++) 
 		{ swap[c] = *i; i += step; }
+	LOG_STAT_MOVES(div);
 	
 	// halve the sample using trim fours
 	
@@ -195,7 +367,7 @@ VAR log_smart_median(VAR *array, VAR *swap, size_t n, size_t bLen) {
 	div *= 4;
 	log_piposort(swap, swap+div, div);
 	
-	return swap[div/2 + 1];
+	return swap + div/2 + 1;
 }
 
 ///////////////
@@ -205,6 +377,16 @@ VAR log_smart_median(VAR *array, VAR *swap, size_t n, size_t bLen) {
 ///////////////
 
 void log_block_xor(VAR *a, VAR *b, size_t v) {
+	LOG_STAT_MOVES(2*log_stats_popcount(v));
+	
+#ifdef LOGSORT_KEY
+	log_xor_fn bxor = log_simd_xor(LOGSORT_KEY);
+	
+	if(bxor) {
+		bxor(a, b, v);
+		return;
+	}
+#endif
 	VAR t;
 	
 	while(v) {
@@ -213,55 +395,1247 @@ void log_block_xor(VAR *a, VAR *b, size_t v) {
 	}
 }
 
+void log_reverse(VAR *a, VAR *b) {
+	VAR t;
+	
+	LOG_STAT_MOVES((b-a)/2*2);
+	
+	while(a < --b) { t = *a; *a++ = *b; *b = t; }
+}
+VAR *log_rotate(VAR *a, VAR *m, VAR *b) { // [a, m) [m, b) -> [m, b) [a, m)
+	log_reverse(a, m);
+	log_reverse(m, b);
+	log_reverse(a, b);
+	
+	return a + (b-m);
+}
+
+#ifdef _OPENMP
+
+void log_reverse_parallel(VAR *a, VAR *b) {
+	size_t i, h = (b-a) / 2;
+	VAR *e = b-1;
+	
+	if(h < MIN_PARALLEL) {
+		log_reverse(a, b);
+		return;
+	}
+	#pragma omp taskloop grainsize(MIN_PARALLEL)
+	for(i = 0; i < h; i++) {
+		VAR t = a[i]; a[i] = *(e-i); *(e-i) = t;
+	}
+}
+VAR *log_rotate_parallel(VAR *a, VAR *m, VAR *b) {
+	log_reverse_parallel(a, m);
+	log_reverse_parallel(m, b);
+	log_reverse_parallel(a, b);
+	
+	return a + (b-m);
+}
+
+#endif
+
 #define PIVFUNC(NAME) NAME##_less
+#define PIVTYPE VAR
 #define PIVCMP(a, b) (CMP((b), (a)) > 0)
+#define PIVOP LOG_OP_LT
 
 #include "logPartition.c"
 
 #undef PIVFUNC
+#undef PIVTYPE
 #undef PIVCMP
+#undef PIVOP
 
 #define PIVFUNC(NAME) NAME##_less_eq
+#define PIVTYPE VAR
 #define PIVCMP(a, b) (CMP((a), (b)) <= 0)
+#define PIVOP LOG_OP_LE
 
 #include "logPartition.c"
 
 #undef PIVFUNC
+#undef PIVTYPE
 #undef PIVCMP
+#undef PIVOP
+
+// three-way partition: one grouping pass keeps < piv elements in place and collects == and
+// > piv elements in the two halves of s, emitting full blocks of half length.  The blocks
+// of all three classes are then ordered by one block partition, or with LOGSORT_MIN_CMP by
+// a < / >= and a == / > block partition.  Returns the start of the == run and sets *eq to
+// its end
+
+VAR *log_partition_three_easy(VAR *a, VAR *s, size_t n, VAR *piv, VAR **eq) {
+	size_t i, l = 0, r = 0, g = n;
+	char x, y;
+	
+	LOG_STAT_ENTER(LOG_PH_GROUP);
+	
+	for(i = 0; i < n; i++) { // > piv fill s from the back
+		x = CMP(piv, a+i) > 0; y = CMP(a+i, piv) > 0;
+		a[l] = a[i]; s[r] = a[i]; s[g-1] = a[i];
+		l += x; r += !(x | y); g -= y;
+	}
+	VAR *m = a+l;
+	
+	LOG_STAT_MOVES(3*n + n-g);
+	memcpy(m, s, r * sizeof(VAR));
+	*eq = m+r;
+	
+	for(i = n; i > g; i--) m[r++] = s[i-1];
+	
+	LOG_STAT_LEAVE();
+	return m;
+}
+// three way block partition.  Block classes are read from an element past the tags: 0 for
+// < piv, 1 for == piv and 2 for > piv
+
+int log_block_class(VAR *a, VAR *piv) {
+	return CMP(piv, a) > 0 ? 0 : 1 + (CMP(a, piv) > 0);
+}
+
+// tag bits of a class c block: the positions holding an element of another class
+
+size_t log_block_read_three(VAR *a, VAR *piv, int c, char wLen) {
+	size_t mask = ((size_t)1 << wLen) - 1;
+	
+	if(c == 0) return mask ^ log_block_read_less(a, piv, wLen);
+	if(c == 2) return log_block_read_less_eq(a, piv, wLen);
+	
+	return log_block_read_less(a, piv, wLen) | (mask ^ log_block_read_less_eq(a, piv, wLen));
+}
+
+// encodes v in three blocks of distinct classes by rotating their elements a <- b <- c at
+// the set bits, or decodes it with back set
+
+void log_block_rotate(VAR *a, VAR *b, VAR *c, size_t v, char back) {
+	LOG_STAT_MOVES(3*log_stats_popcount(v));
+	VAR t;
+	
+	for(; v; v >>= 1, a++, b++, c++) {
+		if(!(v & 1)) continue;
+		
+		if(back) { t = *c; *c = *b; *b = *a; *a = t; }
+		else     { t = *a; *a = *b; *b = *c; *c = t; }
+	}
+}
+
+// stably sorts the blocks of bLen elements of three classes in one pass: the largest class
+// is swapped into place, and the blocks of rank v in the other two are tagged with v, in
+// a pair or triple with the rank v block of the largest.  Those blocks are then cycle
+// sorted by class and tag, without first splitting off < piv like two block partitions
+
+void log_block_partition_three(VAR *a, size_t *cnt, size_t bLen, VAR *piv) {
+	size_t start[3] = {0, cnt[0], cnt[0]+cnt[1]}, b = start[2]+cnt[2];
+	int m = cnt[1] >= cnt[0] && cnt[1] >= cnt[2] ? 1 : cnt[0] >= cnt[2] ? 0 : 2;
+	size_t i, j, k, v, max = 0;
+	int c;
+	
+	for(c = 0; c < 3; c++)
+		if(c != m && cnt[c] > max) max = cnt[c];
+	
+	if(!max) return;
+	
+	char wLen = log_ceil_log(max);
+	VAR *pc[3] = {a, a, a}, *pv[3];
+	
+	// encode ranks in pairs or triples of blocks
+	
+	LOG_STAT_ENTER(LOG_PH_ENCODE);
+	
+	for(v = 0; v < max; v++) {
+		for(c = 0, k = 0; c < 3; c++) {
+			if(v >= cnt[c]) continue;
+			
+			while(log_block_class(pc[c]+wLen, piv) != c) pc[c] += bLen;
+			pv[k++] = pc[c]; pc[c] += bLen;
+		}
+		if(k == 3) log_block_rotate(pv[0], pv[1], pv[2], v, 0);
+		else       log_block_xor(pv[0], pv[1], v);
+	}
+	
+	// swap blocks of the largest class into place: those before their place from the back,
+	// starting from the first one that is not
+	
+	LOG_STAT_SET(LOG_PH_SWAP);
+	VAR *pm = a + start[m]*bLen, *pe = pm + cnt[m]*bLen, *pa, *pb = a, *q;
+	
+	for(i = 0; i < cnt[m]; pb += bLen) {
+		if(log_block_class(pb+wLen, piv) == m) {
+			if(pb >= pm + i*bLen) break;
+			i++;
+		}
+	}
+	for(pa = pm + i*bLen, q = pb; pa > pm; ) {
+		q -= bLen;
+		
+		if(log_block_class(q+wLen, piv) == m) {
+			pa -= bLen;
+			log_swap_bytes(pa, q, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+		}
+	}
+	for(pa = pm + i*bLen, q = pb; pa < pe; q += bLen) {
+		if(log_block_class(q+wLen, piv) == m) {
+			if(pa != q) {
+				log_swap_bytes(pa, q, bLen * sizeof(VAR));
+				LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			}
+			pa += bLen;
+		}
+	}
+	
+	// block cycle sort of the other two classes: as in log_block_partition, the next block
+	// of a cycle is decoded before the swap and prefetched
+	
+	LOG_STAT_SET(LOG_PH_CYCLE);
+	
+	for(i = 0; i < b; i++) {
+		if(i == start[m]) i += cnt[m];
+		if(i == b) break;
+		
+		pa = a + i*bLen;
+		c = log_block_class(pa+wLen, piv);
+		j = start[c] + log_block_read_three(pa, piv, c, wLen);
+		
+		while(j != i) {
+			VAR *pj = a + j*bLen;
+			c = log_block_class(pj+wLen, piv);
+			k = start[c] + log_block_read_three(pj, piv, c, wLen);
+			
+			if(k != i) log_prefetch(a + k*bLen, bLen * sizeof(VAR));
+			
+			log_swap_bytes(pa, pj, bLen * sizeof(VAR));
+			LOG_STAT_BYTES(2*bLen * sizeof(VAR));
+			j = k;
+		}
+	}
+	
+	// decode the ranks, now that the blocks of rank v sit at start[c] + v
+	
+	for(v = 0; v < max; v++) {
+		for(c = 0, k = 0; c < 3; c++)
+			if(v < cnt[c]) pv[k++] = a + (start[c]+v)*bLen;
+		
+		if(k == 3) log_block_rotate(pv[0], pv[1], pv[2], v, 1);
+		else       log_block_xor(pv[0], pv[1], v);
+	}
+	LOG_STAT_LEAVE();
+}
+
+VAR *log_partition_three(VAR *a, VAR *s, size_t n, size_t bLen, VAR *piv, VAR **eq) {
+	if(n <= bLen) return log_partition_three_easy(a, s, n, piv, eq);
+	
+	size_t hLen = bLen/2;
+	
+	if((size_t)log_ceil_log(n / (2*hLen)) >= hLen) { // blocks too short for their tags: use two passes
+		*eq = log_partition_less_eq(a, s, n, bLen, piv);
+		return log_partition_less(a, s, *eq-a, bLen, piv);
+	}
+	
+	// group into blocks
+	
+	VAR *p, *s1 = s, *s2 = s+hLen;
+	size_t i = 0, l = 0, r1 = 0, r2 = 0, b1 = 0, b2 = 0, rem;
+	char x, y;
+	
+	LOG_STAT_ENTER(LOG_PH_GROUP);
+	
+#ifdef LOGSORT_KEY
+	log_group3_fn group = log_simd_group3(LOGSORT_KEY); // vectorised grouping
+	
+	if(group) {
+		size_t g[6] = {0, 0, 0, 0, 0, 0};
+		group(a, s, piv, n, hLen, g);
+		i = g[0]; l = g[1]; r1 = g[2]; r2 = g[3]; b1 = g[4]; b2 = g[5];
+		LOG_STAT_CMP(2*i);
+	}
+#endif
+	for(; i < n; i++) {
+		x = CMP(piv, a+i) > 0; y = CMP(a+i, piv) > 0;
+		a[l] = a[i]; s1[r1] = a[i]; s2[r2] = a[i];
+		l += x; r1 += !(x | y); r2 += y;
+		
+		if(r1 == hLen || r2 == hLen) { // a bucket is full: empty block in main array
+			VAR *t = r1 == hLen ? s1 : s2;
+			
+			rem = l % hLen;
+			p = a+l - rem;
+			
+			memcpy(p+hLen, p, rem * sizeof(VAR));
+			memcpy(p, t, hLen * sizeof(VAR));
+			
+			l += hLen;
+			if(t == s1) { r1 = 0; b1++; }
+			else        { r2 = 0; b2++; }
+		}
+	}
+	LOG_STAT_MOVES(3*n);
+	
+	p = a+l;
+	memcpy(p,    s1, r1 * sizeof(VAR));
+	memcpy(p+r1, s2, r2 * sizeof(VAR));
+	l %= hLen; p -= l;
+	
+	size_t b0 = (p-a)/hLen - b1 - b2;
+	VAR *m0 = a + b0*hLen, *m1 = m0 + b1*hLen;
+	
+#ifdef LOGSORT_MIN_CMP // two way block partitions cache block types instead of reading tags
+	log_block_partition_less(a, s, b0, b1+b2, hLen, piv);
+	log_block_partition_less_eq(m0, s, b1, b2, hLen, piv);
+#else
+	size_t cnt[3] = {b0, b1, b2};
+	log_block_partition_three(a, cnt, hLen, piv);
+#endif
+	
+	// clean up leftovers: the < and == fragments sit together before the > fragment
+	
+	LOG_STAT_SET(LOG_PH_CLEANUP);
+	memcpy(s, p, (l+r1) * sizeof(VAR));
+	memmove(m1+l+r1, m1, b2*hLen * sizeof(VAR));
+	memmove(m0+l,    m0, b1*hLen * sizeof(VAR));
+	memcpy(m0,      s,   l  * sizeof(VAR));
+	memcpy(m1+l,    s+l, r1 * sizeof(VAR));
+	
+	*eq = m1+l+r1;
+	
+	LOG_STAT_LEAVE();
+	return m0+l;
+}
+
+// first element of [lo, hi) not less than / greater than x
+
+VAR *log_lower_bound(VAR *lo, VAR *hi, VAR *x) {
+	while(lo < hi) {
+		VAR *y = lo + (hi-lo)/2;
+		
+		if(CMP(x, y) > 0) lo = y+1;
+		else hi = y;
+	}
+	return lo;
+}
+VAR *log_upper_bound(VAR *lo, VAR *hi, VAR *x) {
+	while(lo < hi) {
+		VAR *y = lo + (hi-lo)/2;
+		
+		if(CMP(y, x) > 0) hi = y;
+		else lo = y+1;
+	}
+	return lo;
+}
+
+// stable merge of [a, m) and [m, b) with a buffer of bLen elements.  The prefix and suffix
+// already in place are skipped and runs entirely in reverse order are rotated.  Otherwise
+// merging is linear if either run fits in the buffer, else the shorter run is split at its
+// middle and the longer run where that element belongs, the parts in between are rotated
+// and both halves merged in turn: O(n log(k/bLen)) moves for a shorter run of k elements
+// and O(log n) stack
+
+void log_merge(VAR *a, VAR *m, VAR *b, VAR *s, size_t bLen) {
+	if(a == m || m == b || CMP(m-1, m) <= 0) return;
+	
+	a = log_upper_bound(a, m, m);
+	b = log_lower_bound(m, b, m-1);
+	
+	if(CMP(a, b-1) > 0) {
+		log_rotate(a, m, b);
+		return;
+	}
+	while(a < m && m < b) {
+		size_t l = m-a, r = b-m;
+		
+		if(l <= bLen) { // forward merge from the buffer
+			VAR *i = s, *e = s+l, *j = m;
+			
+			memcpy(s, a, l * sizeof(VAR));
+			
+			while(i < e && j < b) *a++ = CMP(i, j) <= 0 ? *i++ : *j++;
+			
+			LOG_STAT_MOVES(l - (e-i) + (j-m));
+			memcpy(a, i, (e-i) * sizeof(VAR));
+			
+			return;
+		}
+		if(r <= bLen) { // backward merge from the buffer
+			VAR *i = m, *j = s+r;
+			
+			memcpy(s, m, r * sizeof(VAR));
+			
+			while(a < i && s < j) *--b = CMP(i-1, j-1) > 0 ? *--i : *--j;
+			
+			LOG_STAT_MOVES(r - (j-s) + (m-i));
+			memcpy(a, s, (j-s) * sizeof(VAR));
+			
+			return;
+		}
+		VAR *x, *y, *z;
+		
+		if(l <= r) { x = a + l/2; y = log_lower_bound(m, b, x); }
+		else       { y = m + r/2; x = log_upper_bound(a, m, y); }
+		
+		z = log_rotate(x, m, y);
+		
+		if(z-a < b-z) { // recurse into the smaller half
+			log_merge(a, x, z, s, bLen);
+			a = z; m = y;
+		}
+		else {
+			log_merge(z, y, b, s, bLen);
+			b = z; m = x;
+		}
+	}
+}
+
+// worst-case fallback: bottom-up merge sort of runs sorted by piposort, O(n log n)
+// comparisons and O(n log^2 n) moves
+
+void log_merge_sort(VAR *a, VAR *s, size_t n, size_t bLen) {
+	size_t run = bLen < MIN_PIPOSORT ? bLen : MIN_PIPOSORT, i, w;
+	
+	LOG_STAT_ENTER(LOG_PH_MERGE);
+	
+	for(i = 0; i < n; i += run)
+		log_piposort(a+i, s, n-i < run ? n-i : run);
+	
+	for(w = run; w < n; w *= 2)
+		for(i = 0; i+w < n; i += 2*w)
+			log_merge(a+i, a+i+w, a + (n-i < 2*w ? n : i+2*w), s, bLen);
+	
+	LOG_STAT_LEAVE();
+}
 
 // logsort sorting functions
 
-void logsort_rec(VAR *a, VAR *s, size_t n, size_t bLen) {
+// partitions around a pivot chosen from a sample: three ways if it repeats on both sides
+// in the sample, else into <= and > piv, or < and == piv if no element is greater.
+// Returns the end of the first part and sets *gt to the start of the > part
+
+VAR *log_pivot_partition(VAR *a, VAR *s, size_t n, size_t bLen, VAR **gt) {
+	LOG_STAT_ENTER(LOG_PH_PIVOT);
+	
+	VAR *pp = n < 2048 ? log_median_of_nine(a, s, n)
+	                   : log_smart_median(a, s, n, bLen);
+	VAR piv = *pp, *p;
+	
+	LOG_STAT_LEAVE();
+	
+	if(CMP(pp, pp-1) <= 0 && CMP(pp+1, pp) <= 0) // pivot repeats on both sides in the sample
+		return log_partition_three(a, s, n, bLen, &piv, gt);
+	
+	p = log_partition_less_eq(a, s, n, bLen, &piv);
+	*gt = p;
+	
+	if(p == a+n) // in the case of many equal elements
+		p = log_partition_less(a, s, n, bLen, &piv);
+	
+	return p;
+}
+
+// like introsort, logsort_rec allows up to bad unbalanced partitions, whose larger part
+// keeps over 15/16 of the elements, before merge sorting the rest.  It recurses into the
+// smaller part, so adversarial inputs cost O(n log^2 n) time and O(log n) stack at worst
+
+void logsort_rec(VAR *a, VAR *s, size_t n, size_t bLen, char bad) {
+	size_t minSort = bLen < MIN_PIPOSORT ? bLen : MIN_PIPOSORT;
+	
+	LOG_STAT_ENTER(LOG_PH_OTHER);
+	
+	while(n > minSort) {
+		VAR *gt, *p = log_pivot_partition(a, s, n, bLen, &gt);
+		size_t l = p-a, r = a+n - gt;
+		
+		LOG_STAT_PART(n, l > r ? l : r); // the parts are one level deeper
+		
+		if((l > r ? l : r) > n - n/16 && !bad--) {
+			log_merge_sort(a, s, n, bLen);
+			LOG_STAT_LEAVE();
+			return;
+		}
+		if(l < r) {
+			if(l) logsort_rec(a, s, l, bLen, bad);
+			a = gt; n = r;
+		}
+		else {
+			if(r) logsort_rec(gt, s, r, bLen, bad);
+			n = l;
+		}
+	}
+	LOG_STAT_SET(LOG_PH_LEAF);
+	log_piposort(a, s, n);
+	LOG_STAT_LEAVE();
+}
+
+// sorts only the positions [lo, hi) of a: afterwards they hold what a stable sort would put
+// there, preceded by the elements before them and followed by those after them in any
+// order.  Recurses only into the parts overlapping [lo, hi), expected O(n + k log k) time
+
+void logsort_rec_range(VAR *a, VAR *s, size_t n, size_t bLen, size_t lo, size_t hi, char bad) {
+	size_t minSort = bLen < MIN_PIPOSORT ? bLen : MIN_PIPOSORT;
+	
+	while(n > minSort) {
+		if(lo == 0 && hi == n) {
+			logsort_rec(a, s, n, bLen, bad);
+			return;
+		}
+		VAR *gt, *p = log_pivot_partition(a, s, n, bLen, &gt);
+		size_t m = p-a, g = gt-a;
+		
+		if((m > n-g ? m : n-g) > n - n/16 && !bad--) {
+			log_merge_sort(a, s, n, bLen);
+			return;
+		}
+		if(lo < m && hi > g) { // both parts: recurse into the smaller
+			if(m < n-g) {
+				logsort_rec_range(a, s, m, bLen, lo, m, bad);
+				a = gt; n -= g; lo = 0; hi -= g;
+			}
+			else {
+				logsort_rec_range(gt, s, n-g, bLen, 0, hi-g, bad);
+				n = m; hi = m;
+			}
+		}
+		else if(lo < m) { // only the first part
+			n = m;
+			if(hi > m) hi = m;
+		}
+		else if(hi > g) { // only the > part
+			a = gt; n -= g; hi -= g;
+			lo = lo > g ? lo-g : 0;
+		}
+		else return; // the == part is in place
+	}
+	log_piposort(a, s, n);
+}
+
+// natural runs: a branchless pass counts descents and changes of direction, stopping once
+// the runs are known to be short.  Sorted input costs just this pass, non-increasing input
+// is reversed and its runs of equal elements reversed back.  If the runs are long on average, ascending and strictly descending runs
+// (reversed, which keeps them stable) of at least MIN_RUN elements are found.  Unless many
+// elements lie between runs or the runs start far before where they belong, which would
+// make merging cost more than partitioning, the elements between runs are sorted by
+// logsort_rec and the pieces merged on a stack whose lengths more than double downwards
+
+size_t log_run_end(VAR *a, size_t i, size_t n) {
+	size_t j = i+1;
+	
+	if(j < n && CMP(a+i, a+j) > 0) {
+		while(j < n && CMP(a+j-1, a+j) > 0) j++;
+		if(j-i >= MIN_RUN) log_reverse(a+i, a+j);
+	}
+	else while(j < n && CMP(a+j-1, a+j) <= 0) j++;
+	
+	return j;
+}
+size_t log_push_run(VAR **run, size_t k, VAR *q, VAR *p, VAR *s, size_t bLen) {
+	LOG_STAT_ENTER(LOG_PH_MERGE);
+	
+	while(k && (size_t)(q - run[k-1]) <= 2*(size_t)(p-q)) {
+		log_merge(run[k-1], q, p, s, bLen);
+		q = run[--k];
+	}
+	run[k] = q;
+	
+	LOG_STAT_LEAVE();
+	return k+1;
+}
+void log_sort_runs(VAR *a, VAR *s, size_t n, size_t bLen) {
+	size_t i, j, t, d, c = 0, g = 0, e = 0, k = 0;
+	char x, y;
+	
+	if(n < 2) return;
+	
+	LOG_STAT_ENTER(LOG_PH_RUNS);
+	d = y = CMP(a, a+1) > 0;
+	
+	for(i = 1; i < n-1 && c <= n / MIN_RUN; ) { // until the runs are known to be short
+		size_t end = n-1 - i > 256 ? i+256 : n-1;
+		
+		for(; i < end; i++) {
+			x = CMP(a+i, a+i+1) > 0;
+			d += x; c += x ^ y; y = x;
+		}
+	}
+	if(d == 0 && i >= n-1) {
+		LOG_STAT_LEAVE();
+		return;
+	}
+	
+	for(i = 1; i < n && CMP(a+i, a+i-1) <= 0; i++) {}
+	
+	if(i == n) {
+		log_reverse(a, a+n);
+		
+		for(i = 0; i < n; i = j) {
+			for(j = i+1; j < n && CMP(a+j, a+i) <= 0; j++) {}
+			log_reverse(a+i, a+j);
+		}
+		LOG_STAT_LEAVE();
+		return;
+	}
+	if(c > n / MIN_RUN) {
+		logsort_rec(a, s, n, bLen, log_ceil_log(n));
+		LOG_STAT_LEAVE();
+		return;
+	}
+	// g counts the elements between runs, e sums how far back each run starts
+	
+	for(i = 0; i < n; i = j) {
+		j = log_run_end(a, i, n);
+		
+		if(j-i < MIN_RUN) {
+			g += j-i;
+			continue;
+		}
+		for(t = 1; t <= i && CMP(a+i-t, a+i) > 0; t *= 2) {}
+		e += t;
+	}
+	if(g > n/8 || e > n * log_ceil_log(n) / 4) {
+		logsort_rec(a, s, n, bLen, log_ceil_log(n));
+		LOG_STAT_LEAVE();
+		return;
+	}
+	VAR *run[64], *r = a; // start of the elements between runs
+	
+	for(i = 0; i < n; i = j) {
+		j = log_run_end(a, i, n);
+		if(j-i < MIN_RUN) continue;
+		
+		if(r < a+i) {
+			logsort_rec(r, s, a+i - r, bLen, log_ceil_log(a+i - r));
+			k = log_push_run(run, k, r, a+i, s, bLen);
+		}
+		k = log_push_run(run, k, a+i, a+j, s, bLen);
+		r = a+j;
+	}
+	if(r < a+n) {
+		logsort_rec(r, s, a+n - r, bLen, log_ceil_log(a+n - r));
+		k = log_push_run(run, k, r, a+n, s, bLen);
+	}
+	LOG_STAT_SET(LOG_PH_MERGE);
+	for(; k > 1; k--) log_merge(run[k-2], run[k-1], a+n, s, bLen);
+	
+	LOG_STAT_LEAVE();
+}
+
+// sorts without heap allocation using a caller-owned buffer of sLen elements, which can be
+// reused across calls but not shared between threads.  If s is NULL or holds less than 9
+// elements, a buffer of at most STACK_LEN elements on the stack is used instead
+
+void logsort_range_scratch(VAR *a, size_t n, size_t lo, size_t hi, VAR *s, size_t sLen) {
+	VAR t[STACK_LEN];
+	
+	if(hi > n) hi = n;
+	if(lo >= hi) return;
+	
+	if(n < sLen) sLen = n;
+	if(sLen < 9) { sLen = 9; s = NULL; } // for median of nine
+	
+	if(!s) {
+		s = t;
+		if(sLen > STACK_LEN) sLen = STACK_LEN;
+	}
+	if(lo == 0 && hi == n) log_sort_runs(a, s, n, sLen);
+	else logsort_rec_range(a, s, n, sLen, lo, hi, log_ceil_log(n));
+}
+void logsort_scratch(VAR *a, size_t n, VAR *s, size_t sLen) {
+	logsort_range_scratch(a, n, 0, n, s, sLen);
+}
+void logsort_range(VAR *a, size_t n, size_t lo, size_t hi, size_t bLen) {
+	if(bLen == LOGSORT_AUTO) bLen = log_auto_blen(sizeof(VAR), n);
+	if(n < bLen) bLen = n;
+	
+	VAR *s = bLen > STACK_LEN ? (VAR*)malloc(bLen * sizeof(VAR)) : NULL;
+	
+	logsort_range_scratch(a, n, lo, hi, s, bLen); // without memory, the stack buffer is used
+	free(s);
+}
+void logsort(VAR *a, size_t n, size_t bLen) {
+	logsort_range(a, n, 0, n, bLen);
+}
+
+// segmented sorting: the nseg segments a[off[i], off[i+1]) are sorted independently with
+// one buffer sized for the longest.  With a 32-bit LOGSORT_KEY, runs of up to
+// LOG_BATCH_SEGS segments of at most LOG_BATCH_LEN keys are sorted together by a
+// vectorised network, one segment per lane
+
+void log_sort_segments(VAR *a, const size_t *off, size_t lo, size_t hi, VAR *s, size_t bLen) {
+	size_t i = lo;
+	
+#ifdef LOGSORT_KEY
+	log_batch_fn batch = log_simd_batch(LOGSORT_KEY);
+#endif
+	while(i < hi) {
+#ifdef LOGSORT_KEY
+		if(batch) {
+			size_t j = i;
+			
+			while(j < hi && j-i < LOG_BATCH_SEGS && off[j+1]-off[j] <= LOG_BATCH_LEN) j++;
+			
+			if(j-i > 1) {
+				batch(a, off+i, j-i);
+				i = j;
+				continue;
+			}
+		}
+#endif
+		logsort_scratch(a + off[i], off[i+1]-off[i], s, bLen);
+		i++;
+	}
+}
+size_t log_segments_blen(const size_t *off, size_t nseg, size_t bLen) {
+	size_t i, max = 0;
+	
+	for(i = 0; i < nseg; i++) if(off[i+1]-off[i] > max) max = off[i+1]-off[i];
+	
+	if(bLen == LOGSORT_AUTO) bLen = log_auto_blen(sizeof(VAR), max);
+	if(max < bLen) bLen = max;
+	
+	return bLen < 9 ? 9 : bLen;
+}
+void logsort_segmented(VAR *a, const size_t *off, size_t nseg, size_t bLen) {
+	bLen = log_segments_blen(off, nseg, bLen);
+	
+	VAR *s = bLen > STACK_LEN ? (VAR*)malloc(bLen * sizeof(VAR)) : NULL;
+	
+	log_sort_segments(a, off, 0, nseg, s, bLen); // without memory, the stack buffer is used
+	free(s);
+}
+
+// selection: logsort_select puts the element of rank k in a stable sort at a+k, like
+// nth_element, logsort_partial sorts the k smallest elements into a[0, k) and logsort_topk
+// the k largest into a[n-k, n), ties ordered as in a stable sort
+
+void logsort_select(VAR *a, size_t n, size_t k, size_t bLen) {
+	logsort_range(a, n, k, k+1, bLen);
+}
+void logsort_partial(VAR *a, size_t n, size_t k, size_t bLen) {
+	logsort_range(a, n, 0, k, bLen);
+}
+void logsort_topk(VAR *a, size_t n, size_t k, size_t bLen) {
+	logsort_range(a, n, k < n ? n-k : 0, n, bLen);
+}
+
+// times logsort on copies of n sample elements with the minimum buffer length for n and
+// the powers of two above it up to a quarter of the L2 cache, then tunes LOGSORT_AUTO to
+// the fastest for elements of this size.  Returns that length, or 0 without memory
+
+size_t logsort_calibrate(VAR *sample, size_t n) {
+	size_t min = log_min_blen(n), max = log_cache_size(2) / (4*sizeof(VAR)), b, p, best = 0, t;
+	clock_t c, bestC = 0;
+	
+	if(max > n)   max = n;
+	if(max < min) max = min;
+	
+	VAR *a = (VAR*)malloc(n * sizeof(VAR)), *s = (VAR*)malloc(max * sizeof(VAR));
+	
+	if(a && s) {
+		for(b = min; b <= max; b = p) {
+			for(t = 0; t < 3; t++) {
+				memcpy(a, sample, n * sizeof(VAR));
+				
+				c = clock();
+				logsort_scratch(a, n, s, b);
+				c = clock() - c;
+				
+				if(!best || c < bestC) { best = b; bestC = c; }
+			}
+			for(p = 16; p <= b; p *= 2) {} // next power of two
+		}
+		log_set_tuned_blen(sizeof(VAR), best);
+	}
+	free(a);
+	free(s);
+	
+	return best;
+}
+
+///////////////////////
+//                   //
+//  INDIRECT SORTING  //
+//                   //
+///////////////////////
+
+// for wide records, sort tags instead: pointers into a or indices, sorted by an instance
+// of logsort for the tag type whose CMP compares the records they refer to.  Then the
+// records are moved into sorted order once, following the cycles of the permutation.
+// p[i] / a[idx[i]] is the record to end up at a+i; p and idx are reset to the identity
+
+void log_apply_order(VAR *a, VAR **p, size_t n) {
+	size_t i, j, k;
+	VAR t;
+	
+	for(i = 0; i < n; i++) {
+		if(p[i] == a+i) continue;
+		
+		t = a[i]; j = i;
+		
+		while((k = p[j]-a) != i) {
+			a[j] = a[k]; p[j] = a+j; j = k;
+		}
+		a[j] = t; p[j] = a+j;
+	}
+}
+void log_apply_index(VAR *a, size_t *idx, size_t n) {
+	size_t i, j, k;
+	VAR t;
+	
+	for(i = 0; i < n; i++) {
+		if(idx[i] == i) continue;
+		
+		t = a[i]; j = i;
+		
+		while((k = idx[j]) != i) {
+			a[j] = a[k]; idx[j] = j; j = k;
+		}
+		a[j] = t; idx[j] = j;
+	}
+}
+
+///////////////
+//           //
+//  MERGING  //
+//           //
+///////////////
+
+// stable in-place merge of the sorted ranges a[0, nLeft) and a[nLeft, nLeft+nRight) with a
+// caller-owned buffer of bLen elements; if s is NULL or holds less than 9 elements, STACK_LEN
+// elements on the stack are used instead.  Linear if the shorter range fits in the buffer.
+// logmerge_append sorts m elements appended to n sorted ones and merges them in, so adding
+// a batch costs O(n + m log m) instead of sorting all n+m elements again
+
+void logmerge(VAR *a, size_t nLeft, size_t nRight, VAR *s, size_t bLen) {
+	VAR t[STACK_LEN];
+	
+	if(!s || bLen < 9) { s = t; bLen = STACK_LEN; }
+	
+	LOG_STAT_ENTER(LOG_PH_MERGE);
+	log_merge(a, a+nLeft, a+nLeft+nRight, s, bLen);
+	LOG_STAT_LEAVE();
+}
+void logmerge_append(VAR *a, size_t n, size_t m, VAR *s, size_t bLen) {
+	logsort_scratch(a+n, m, s, bLen);
+	logmerge(a, n, m, s, bLen);
+}
+
+////////////////////////
+//                    //
+//  STABLE PARTITION  //
+//                    //
+////////////////////////
+
+// logPartition.c instantiated with a unary predicate in place of the pivot comparison:
+// elements satisfying it form the 0's.  The C++ front end defines LOGSORT_PRED(a) to inline
+// a functor, otherwise the predicate is a function pointer passed with its context as piv
+
+#ifdef LOGSORT_PRED
+	#define PIVTYPE void
+	#define PIVCMP(a, piv) (!!(LOGSORT_PRED(a)))
+#else
+	typedef struct {
+		int (*f)(const VAR *a, void *ctx);
+		void *ctx;
+	} log_predicate;
+	
+	#define PIVTYPE log_predicate
+	#define PIVCMP(a, piv) (!!(piv)->f((a), (piv)->ctx))
+#endif
+#define PIVFUNC(NAME) NAME##_pred
+
+#include "logPartition.c"
+
+VAR *log_stable_partition_buf(VAR *a, size_t n, VAR *s, size_t bLen, PIVTYPE *piv) {
+	VAR t[STACK_LEN];
+	
+	if(!n) return a;
+	if(!s || bLen < 9) { s = t; bLen = STACK_LEN; }
+	
+	return log_partition_pred(a, s, n, bLen < n ? bLen : n, piv);
+}
+
+#undef PIVFUNC
+#undef PIVTYPE
+#undef PIVCMP
+
+// stable partition in place, like std::stable_partition: moves the elements satisfying
+// pred before the others, keeping the order within both, and returns the first of the
+// others.  s is a caller-owned buffer of bLen elements; if it is NULL or holds less than 9
+// elements, STACK_LEN elements on the stack are used instead
+
+#ifdef LOGSORT_PRED
+
+VAR *log_stable_partition(VAR *a, size_t n, VAR *s, size_t bLen) {
+	return log_stable_partition_buf(a, n, s, bLen, NULL);
+}
+
+#else
+
+VAR *log_stable_partition(VAR *a, size_t n, int (*pred)(const VAR *a, void *ctx), void *ctx, VAR *s, size_t bLen) {
+	log_predicate p = {pred, ctx};
+	
+	return log_stable_partition_buf(a, n, s, bLen, &p);
+}
+
+#endif
+
+#if defined(LOGSORT_RADIX) || defined(LOGSORT_KEY)
+
+/////////////////////
+//                 //
+//  RADIX SORTING  //
+//                 //
+/////////////////////
+
+// MSD radix mode: logsort_rec with the sampled pivot replaced by the highest key bit that
+// differs within the subrange, so no samples or comparisons are needed to split it.  Keys
+// are the unsigned images of LOGSORT_RADIX(a) if defined, which must order like CMP, else of
+// an integer LOGSORT_KEY; floating point keys fall back to logsort.  Each level consumes a
+// bit, so the worst case is O(n * keybits) time with O(log n) stack
+
+#ifdef LOGSORT_RADIX
+	#define LOG_RADIX_OK 1
+#else
+	#define LOG_RADIX_OK (LOGSORT_KEY && LOGSORT_KEY != LOG_KEY_F32 && LOGSORT_KEY != LOG_KEY_F64)
+#endif
+
+uint64_t log_radix_key(const VAR *a) {
+#ifdef LOGSORT_RADIX
+	return (uint64_t)(LOGSORT_RADIX(a));
+#else
+	switch(LOGSORT_KEY) {
+		case LOG_KEY_I32: return (uint32_t)log_bits32(a) ^ 0x80000000u;
+		case LOG_KEY_U32: return (uint32_t)log_bits32(a);
+		case LOG_KEY_I64: return (uint64_t)log_bits64(a) ^ ((uint64_t)1 << 63);
+		default:          return (uint64_t)log_bits64(a);
+	}
+#endif
+}
+
+#ifdef LOGSORT_RADIX
+
+// elements with the bit clear form the 0's
+
+#define PIVFUNC(NAME) NAME##_bit
+#define PIVTYPE uint64_t
+#define PIVCMP(a, piv) (!(log_radix_key(a) & *(piv)))
+
+#include "logPartition.c"
+
+#undef PIVFUNC
+#undef PIVTYPE
+#undef PIVCMP
+
+#else
+
+// keys share the bits above the split bit, so it is clear exactly in the keys less than
+// their common prefix with the bit set: primitive keys split with the vectorised
+// log_partition_less on that value instead
+
+void log_radix_pivot(VAR *piv, uint64_t k) {
+	uint32_t x = (uint32_t)k ^ (LOGSORT_KEY == LOG_KEY_I32 ? 0x80000000u : 0);
+	
+	if(LOGSORT_KEY == LOG_KEY_I64) k ^= (uint64_t)1 << 63;
+	
+	if(sizeof(VAR) == 4) memcpy(piv, &x, sizeof(VAR) < 4 ? sizeof(VAR) : 4);
+	else                 memcpy(piv, &k, sizeof(VAR) < 8 ? sizeof(VAR) : 8);
+}
+
+#endif
+
+// bits differing between the keys of a[0, n)
+
+uint64_t log_radix_diff(VAR *a, size_t n) {
+	uint64_t lo = log_radix_key(a), hi = lo, k;
+	size_t i;
+	
+	for(i = 1; i < n; i++) {
+		k = log_radix_key(a+i);
+		lo &= k; hi |= k;
+	}
+	return lo ^ hi;
+}
+
+// diff holds the bits that may still differ in the subrange.  Rescanning every level would
+// cost about as much as partitioning, so it is only done after a split puts all elements
+// on one side, which also finds subranges whose keys are all equal
+
+void logsort_radix_rec(VAR *a, VAR *s, size_t n, size_t bLen, uint64_t diff) {
+	size_t minSort = bLen < MIN_PIPOSORT ? bLen : MIN_PIPOSORT;
+	
+	while(n > minSort) {
+		if(!diff) return; // bit range collapsed: all keys equal
+		
+		uint64_t bit = (uint64_t)1 << 63;
+		while(!(bit & diff)) bit >>= 1;
+		
+#ifdef LOGSORT_RADIX
+		VAR *p = log_partition_bit(a, s, n, bLen, &bit);
+#else
+		VAR piv;
+		log_radix_pivot(&piv, (log_radix_key(a) & ~(2*bit-1)) | bit);
+		
+		VAR *p = log_partition_less(a, s, n, bLen, &piv);
+#endif
+		size_t l = p-a, r = n-l;
+		diff &= bit-1;
+		
+		if(!l || !r) {
+			diff = log_radix_diff(a, n);
+			continue;
+		}
+		if(l < r) {
+			logsort_radix_rec(a, s, l, bLen, diff);
+			a = p; n = r;
+		}
+		else {
+			logsort_radix_rec(p, s, r, bLen, diff);
+			n = l;
+		}
+	}
+	log_piposort(a, s, n);
+}
+void logsort_radix_scratch(VAR *a, size_t n, VAR *s, size_t sLen) {
+	VAR t[STACK_LEN];
+	
+	if(!LOG_RADIX_OK) {
+		logsort_scratch(a, n, s, sLen);
+		return;
+	}
+	if(n < sLen) sLen = n;
+	if(sLen < 9) { sLen = 9; s = NULL; }
+	
+	if(!s) {
+		s = t;
+		if(sLen > STACK_LEN) sLen = STACK_LEN;
+	}
+	if(n) logsort_radix_rec(a, s, n, sLen, log_radix_diff(a, n));
+}
+void logsort_radix(VAR *a, size_t n, size_t bLen) {
+	if(bLen == LOGSORT_AUTO) bLen = log_auto_blen(sizeof(VAR), n);
+	if(n < bLen) bLen = n;
+	
+	VAR *s = bLen > STACK_LEN ? (VAR*)malloc(bLen * sizeof(VAR)) : NULL;
+	
+	logsort_radix_scratch(a, n, s, bLen);
+	free(s);
+}
+
+#undef LOG_RADIX_OK
+
+#endif
+
+////////////////////////
+//                    //
+//  EXTERNAL SORTING  //
+//                    //
+////////////////////////
+
+#include "logExternal.c"
+
+#ifdef _OPENMP
+
+// parallel logsort: subproblems of at least MIN_PARALLEL elements become OpenMP tasks,
+// which idle threads steal.  s holds one bLen buffer per thread, so a task always uses
+// the buffer of the thread running it
+
+void logsort_rec_parallel(VAR *a, VAR *s, size_t n, size_t bLen, char bad) {
 	size_t minSort = bLen < MIN_PIPOSORT ? bLen : MIN_PIPOSORT;
+	VAR *t = s + omp_get_thread_num() * bLen;
 	
 	while(n > minSort) {
-		VAR piv = n < 2048 ? log_median_of_nine(a, s, n)
-		                   : log_smart_median(a, s, n, bLen);
+		if(n < MIN_PARALLEL) {
+			logsort_rec(a, t, n, bLen, bad);
+			return;
+		}
+		VAR piv = *log_smart_median(a, t, n, bLen);
 		
-		VAR *p = log_partition_less_eq(a, s, n, bLen, &piv);
+		// split large partitions into chunks for the parallel partition
+		
+		size_t c = n / (4*MIN_PARALLEL), threads = omp_get_num_threads();
+		if(c > threads) c = threads;
+		if(c > MAX_PARALLEL_CHUNKS) c = MAX_PARALLEL_CHUNKS;
+		
+		VAR *p = c > 1 ? log_partition_parallel_less_eq(a, s, n, bLen, &piv, c)
+		               : log_partition_less_eq(a, t, n, bLen, &piv);
 		size_t m = p-a;
 		
-		if(m == n) { // in the case of many equal elements
-			p = log_partition_less(a, s, n, bLen, &piv);
-			n = p-a;
+		if(m == n) {
+			p = c > 1 ? log_partition_parallel_less(a, s, n, bLen, &piv, c)
+			          : log_partition_less(a, t, n, bLen, &piv);
+			m = p-a;
+			
+			if(m > n - n/16 && !bad--) {
+				log_merge_sort(a, t, m, bLen);
+				return;
+			}
+			n = m;
 			
 			continue;
 		}
-		logsort_rec(p, s, n-m, bLen);
+		size_t r = n-m;
+		
+		if((m > r ? m : r) > n - n/16 && !bad--) {
+			log_merge_sort(a, t, n, bLen);
+			return;
+		}
+		#pragma omp task firstprivate(p, s, r, bLen, bad)
+		logsort_rec_parallel(p, s, r, bLen, bad);
+		
 		n = m;
 	}
-	log_piposort(a, s, n);
+	log_piposort(a, t, n);
 }
-void logsort(VAR *a, size_t n, size_t bLen) {
+void logsort_parallel(VAR *a, size_t n, size_t bLen) {
+	if(bLen == LOGSORT_AUTO) bLen = log_auto_blen(sizeof(VAR), n);
 	if(n < bLen) bLen = n;
-	if(bLen < 9) bLen = 9; // for median of nine
+	if(bLen < 9) bLen = 9;
+	
+	VAR *s = (VAR*)malloc(omp_get_max_threads() * bLen * sizeof(VAR));
+	
+	if(!s) {
+		logsort_scratch(a, n, NULL, 0);
+		return;
+	}
+	#pragma omp parallel
+	#pragma omp single
+	logsort_rec_parallel(a, s, n, bLen, log_ceil_log(n));
 	
-	VAR *s = malloc(bLen * sizeof(VAR));
-	logsort_rec(a, s, n, bLen);
 	free(s);
 }
 
+// segmented sorting on all threads: chunks of PARALLEL_SEGMENTS segments are handed out
+// dynamically, each thread sorting with its own buffer
+
+void logsort_segmented_parallel(VAR *a, const size_t *off, size_t nseg, size_t bLen) {
+	bLen = log_segments_blen(off, nseg, bLen);
+	
+	VAR *s = (VAR*)malloc(omp_get_max_threads() * bLen * sizeof(VAR));
+	long long i;
+	
+	if(!s) {
+		log_sort_segments(a, off, 0, nseg, NULL, 0);
+		return;
+	}
+	#pragma omp parallel for schedule(dynamic)
+	for(i = 0; i < (long long)nseg; i += PARALLEL_SEGMENTS) {
+		size_t hi = (size_t)i + PARALLEL_SEGMENTS < nseg ? (size_t)i + PARALLEL_SEGMENTS : nseg;
+		
+		log_sort_segments(a, off, i, hi, s + omp_get_thread_num() * bLen, bLen);
+	}
+	free(s);
+}
+
+#endif
+
+#ifdef LOGSORT_STATS
+	#undef CMP
+	#undef memcpy
+	#undef memmove
+	#pragma pop_macro("CMP")
+	#pragma pop_macro("memcpy")
+	#pragma pop_macro("memmove")
+#endif
+#undef LOG_STAT_ENTER
+#undef LOG_STAT_LEAVE
+#undef LOG_STAT_SET
+#undef LOG_STAT_CMP
+#undef LOG_STAT_MOVES
+#undef LOG_STAT_BYTES
+#undef LOG_STAT_PART
+
 #undef MIN_SMALLSORT
 #undef MIN_PIPOSORT
+#undef MIN_RUN
+#undef MIN_PARALLEL
+#undef MAX_PARALLEL_CHUNKS
+#undef PARALLEL_SEGMENTS
+#undef MAX_STACK_BYTES
+#undef STACK_LEN
 
-#endif // LOGSORT_H
+#ifdef LOGSORT_PREFIX
+	#undef log_counted_cmp
+	#undef log_ceil_log
+	#undef log_smallsort
+	#undef log_parity_merge
+	#undef log_piposort
+	#undef log_trim_four
+	#undef log_median_of_nine
+	#undef log_smart_median
+	#undef log_block_xor
+	#undef log_reverse
+	#undef log_rotate
+	#undef log_reverse_parallel
+	#undef log_rotate_parallel
+	#undef log_block_read_less
+	#undef log_block_read_less_eq
+	#undef log_partition_easy_less
+	#undef log_partition_easy_less_eq
+	#undef log_block_partition_less
+	#undef log_block_partition_cached_less
+	#undef log_block_partition_cached_less_eq
+	#undef log_block_partition_less_eq
+	#undef log_partition_less
+	#undef log_partition_less_eq
+	#undef log_partition_parallel_less
+	#undef log_partition_parallel_less_eq
+	#undef log_block_class
+	#undef log_block_read_three
+	#undef log_block_rotate
+	#undef log_block_partition_three
+	#undef log_partition_three_easy
+	#undef log_partition_three
+	#undef log_lower_bound
+	#undef log_upper_bound
+	#undef log_merge
+	#undef log_merge_sort
+	#undef log_pivot_partition
+	#undef logsort_rec
+	#undef logsort
+	#undef log_sort_segments
+	#undef log_segments_blen
+	#undef logsort_segmented
+	#undef logsort_scratch
+	#undef log_run_end
+	#undef log_push_run
+	#undef log_sort_runs
+	#undef logsort_rec_range
+	#undef logsort_range_scratch
+	#undef logsort_range
+	#undef logsort_select
+	#undef logsort_partial
+	#undef logsort_topk
+	#undef logsort_calibrate
+	#undef logmerge
+	#undef logmerge_append
+	#undef log_apply_order
+	#undef log_apply_index
+	#undef log_block_read_pred
+	#undef log_partition_easy_pred
+	#undef log_block_partition_pred
+	#undef log_block_partition_cached_pred
+	#undef log_partition_pred
+	#undef log_partition_parallel_pred
+	#undef log_predicate
+	#undef log_stable_partition_buf
+	#undef log_stable_partition
+	#undef log_radix_key
+	#undef log_radix_pivot
+	#undef log_block_read_bit
+	#undef log_partition_easy_bit
+	#undef log_block_partition_bit
+	#undef log_block_partition_cached_bit
+	#undef log_partition_bit
+	#undef log_partition_parallel_bit
+	#undef log_radix_diff
+	#undef logsort_radix_rec
+	#undef logsort_radix_scratch
+	#undef logsort_radix
+	#undef log_ext_merge
+	#undef logsort_file
+	#undef logsort_rec_parallel
+	#undef logsort_parallel
+	#undef logsort_segmented_parallel
+	
+	#undef LOG_NAME
+	#undef LOG_CONCAT
+	#undef LOG_CONCAT_
+#endif
@@ -0,0 +1,597 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+ 
+#ifndef LOGSORT_HPP
+#define LOGSORT_HPP
+
+// C++ front end: logsort.h is included into a class template, so every element type and
+// comparator gets its own instantiation and comparisons can be inlined.
+//
+// usage: logsort(first, last, comp) or logsort<T, Compare>(array, n, bLen, comp)
+// where comp is a strict weak ordering like std::less<T>.  logsort_scratch(array, n,
+// buffer, bLen, comp) sorts with a caller-owned buffer and no heap allocation.  The buffer
+// length defaults to LOGSORT_AUTO, see logTune.h.  log_stable_partition(first, last, pred)
+// stably partitions by a predicate like std::stable_partition.  logsort_select and
+// logsort_partial are stable counterparts of std::nth_element and std::partial_sort, and
+// logmerge(first, middle, last) of std::inplace_merge.  logsort_radix(first, last[, key])
+// sorts by the bits of integer keys without comparisons.  logsort_file<T>(in, out, memBytes,
+// ioBytes) sorts a binary file of T records larger than memory, see logExternal.c.
+// logsort_columns(n, keys, payload) sorts parallel arrays by tuples of key columns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+#include "logSimd.h"
+#include "logTune.h"
+#include "logStats.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// primitive keys sorted with std::less get the vectorised kernels of logSimd.h
+
+template<class T>
+struct log_key_kind {
+	static const int value = 
+		std::is_same<T, float>::value  ? LOG_KEY_F32 :
+		std::is_same<T, double>::value ? LOG_KEY_F64 :
+		!std::is_integral<T>::value || std::is_same<T, bool>::value ? 0 :
+		sizeof(T) == 4 ? (std::is_signed<T>::value ? LOG_KEY_I32 : LOG_KEY_U32) :
+		sizeof(T) == 8 ? (std::is_signed<T>::value ? LOG_KEY_I64 : LOG_KEY_U64) : 0;
+};
+
+template<class T, class Compare>
+struct log_key_of { static const int value = 0; };
+
+template<class T>
+struct log_key_of<T, std::less<T> > { static const int value = log_key_kind<T>::value; };
+
+#if __cplusplus >= 201402L
+template<class T>
+struct log_key_of<T, std::less<> > { static const int value = log_key_kind<T>::value; };
+#endif
+
+template<class T, class Compare>
+struct logsort_impl {
+	Compare comp;
+	
+	explicit logsort_impl(Compare c) : comp(c) {}
+	
+	// CMP(a, b) > 0 iff *a > *b
+	
+	#define VAR T
+	#define CMP(a, b) (comp(*(b), *(a)))
+	#define LOGSORT_KEY (log_key_of<T, Compare>::value)
+	
+	#include "logsort.h"
+	
+	#undef VAR
+	#undef CMP
+	#undef LOGSORT_KEY
+};
+
+template<class T, class Compare>
+void logsort(T *a, size_t n, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort(a, n, bLen);
+}
+template<class T>
+void logsort(T *a, size_t n, size_t bLen = LOGSORT_AUTO) {
+	logsort(a, n, bLen, std::less<T>());
+}
+
+template<class T, class Compare>
+void logsort_scratch(T *a, size_t n, T *s, size_t sLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_scratch(a, n, s, sLen);
+}
+template<class T>
+void logsort_scratch(T *a, size_t n, T *s, size_t sLen) {
+	logsort_scratch(a, n, s, sLen, std::less<T>());
+}
+
+template<class T, class Compare>
+size_t logsort_calibrate(T *sample, size_t n, Compare comp) {
+	return logsort_impl<T, Compare>(comp).logsort_calibrate(sample, n);
+}
+template<class T>
+size_t logsort_calibrate(T *sample, size_t n) {
+	return logsort_calibrate(sample, n, std::less<T>());
+}
+
+// segmented: sorts the nseg segments a[off[i], off[i+1]) independently with one buffer
+
+template<class T, class Compare>
+void logsort_segmented(T *a, const size_t *off, size_t nseg, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_segmented(a, off, nseg, bLen);
+}
+template<class T>
+void logsort_segmented(T *a, const size_t *off, size_t nseg, size_t bLen = LOGSORT_AUTO) {
+	logsort_segmented(a, off, nseg, bLen, std::less<T>());
+}
+
+// selection: the element of rank k, the k smallest or the k largest in stable sorted order
+
+template<class T, class Compare>
+void logsort_select(T *a, size_t n, size_t k, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_select(a, n, k, bLen);
+}
+template<class T>
+void logsort_select(T *a, size_t n, size_t k, size_t bLen = LOGSORT_AUTO) {
+	logsort_select(a, n, k, bLen, std::less<T>());
+}
+
+template<class T, class Compare>
+void logsort_partial(T *a, size_t n, size_t k, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_partial(a, n, k, bLen);
+}
+template<class T>
+void logsort_partial(T *a, size_t n, size_t k, size_t bLen = LOGSORT_AUTO) {
+	logsort_partial(a, n, k, bLen, std::less<T>());
+}
+
+template<class T, class Compare>
+void logsort_topk(T *a, size_t n, size_t k, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_topk(a, n, k, bLen);
+}
+template<class T>
+void logsort_topk(T *a, size_t n, size_t k, size_t bLen = LOGSORT_AUTO) {
+	logsort_topk(a, n, k, bLen, std::less<T>());
+}
+
+// iterator forms like std::nth_element and std::partial_sort
+
+template<class It, class Compare>
+void logsort_select(It first, It nth, It last, Compare comp) {
+	size_t n = last - first;
+	if(n) logsort_select(&*first, n, (size_t)(nth - first), LOGSORT_AUTO, comp);
+}
+template<class It>
+void logsort_select(It first, It nth, It last) {
+	logsort_select(first, nth, last, std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+template<class It, class Compare>
+void logsort_partial(It first, It middle, It last, Compare comp) {
+	size_t n = last - first;
+	if(n) logsort_partial(&*first, n, (size_t)(middle - first), LOGSORT_AUTO, comp);
+}
+template<class It>
+void logsort_partial(It first, It middle, It last) {
+	logsort_partial(first, middle, last, std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+// indirect sorting for wide records: logsort_indirect sorts pointers to the records, or
+// (prefix(record), index) tags if given a prefix function whose order agrees with comp,
+// comparing records only on equal prefixes.  The records are then moved once into place.
+// logsort_argsort leaves a unchanged and writes the stable sorted order of indices to idx
+
+template<class T, class Compare>
+struct log_deref_compare {
+	Compare comp;
+	
+	bool operator()(const T *a, const T *b) const { return comp(*a, *b); }
+};
+
+template<class T, class Compare>
+struct log_index_compare {
+	const T *a;
+	Compare comp;
+	
+	bool operator()(size_t i, size_t j) const { return comp(a[i], a[j]); }
+};
+
+template<class K>
+struct log_tag {
+	K key;
+	size_t i;
+};
+
+template<class T, class K, class Compare>
+struct log_tag_compare {
+	const T *a;
+	Compare comp;
+	
+	bool operator()(const log_tag<K> &x, const log_tag<K> &y) const {
+		return x.key < y.key || (!(y.key < x.key) && comp(a[x.i], a[y.i]));
+	}
+};
+
+template<class T, class Compare>
+void logsort_indirect(T *a, size_t n, Compare comp) {
+	T **p = (T**)malloc(n * sizeof(T*));
+	
+	if(!p) { // sort the records directly
+		logsort(a, n, LOGSORT_AUTO, comp);
+		return;
+	}
+	for(size_t i = 0; i < n; i++) p[i] = a+i;
+	
+	log_deref_compare<T, Compare> tc = {comp};
+	logsort(p, n, LOGSORT_AUTO, tc);
+	logsort_impl<T, Compare>(comp).log_apply_order(a, p, n);
+	free(p);
+}
+template<class T, class Prefix, class Compare>
+void logsort_indirect(T *a, size_t n, Prefix prefix, Compare comp) {
+	typedef typename std::decay<decltype(prefix(*a))>::type K;
+	log_tag<K> *t = (log_tag<K>*)malloc(n * sizeof(log_tag<K>));
+	
+	if(!t) {
+		logsort(a, n, LOGSORT_AUTO, comp);
+		return;
+	}
+	for(size_t i = 0; i < n; i++) { t[i].key = prefix(a[i]); t[i].i = i; }
+	
+	log_tag_compare<T, K, Compare> tc = {a, comp};
+	logsort(t, n, LOGSORT_AUTO, tc);
+	
+	size_t *idx = (size_t*)(void*)t; // compact the indices into the tag array
+	for(size_t i = 0; i < n; i++) memcpy(idx+i, &t[i].i, sizeof(size_t));
+	
+	logsort_impl<T, Compare>(comp).log_apply_index(a, idx, n);
+	free(t);
+}
+
+template<class T, class Compare>
+void logsort_argsort(const T *a, size_t *idx, size_t n, Compare comp) {
+	for(size_t i = 0; i < n; i++) idx[i] = i;
+	
+	log_index_compare<T, Compare> ic = {a, comp};
+	logsort(idx, n, LOGSORT_AUTO, ic);
+}
+template<class T>
+void logsort_argsort(const T *a, size_t *idx, size_t n) {
+	logsort_argsort(a, idx, n, std::less<T>());
+}
+
+// stable in-place merge of adjacent sorted ranges, like std::inplace_merge, and appending
+// an unsorted batch to a sorted array
+
+template<class T, class Compare>
+void logmerge(T *a, size_t nLeft, size_t nRight, T *s, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logmerge(a, nLeft, nRight, s, bLen);
+}
+template<class T, class Compare>
+void logmerge(T *a, size_t nLeft, size_t nRight, Compare comp) {
+	size_t n = nLeft + nRight, bLen = log_auto_blen(sizeof(T), n);
+	T *s = (T*)malloc(bLen * sizeof(T));
+	
+	logmerge(a, nLeft, nRight, s, bLen, comp);
+	free(s);
+}
+template<class T>
+void logmerge(T *a, size_t nLeft, size_t nRight) {
+	logmerge(a, nLeft, nRight, std::less<T>());
+}
+
+template<class T, class Compare>
+void logmerge_append(T *a, size_t n, size_t m, T *s, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logmerge_append(a, n, m, s, bLen);
+}
+template<class T, class Compare>
+void logmerge_append(T *a, size_t n, size_t m, Compare comp) {
+	size_t bLen = log_auto_blen(sizeof(T), n+m);
+	T *s = (T*)malloc(bLen * sizeof(T));
+	
+	logmerge_append(a, n, m, s, bLen, comp);
+	free(s);
+}
+template<class T>
+void logmerge_append(T *a, size_t n, size_t m) {
+	logmerge_append(a, n, m, std::less<T>());
+}
+
+template<class It, class Compare>
+void logmerge(It first, It middle, It last, Compare comp) {
+	if(first != last) logmerge(&*first, (size_t)(middle - first), (size_t)(last - middle), comp);
+}
+template<class It>
+void logmerge(It first, It middle, It last) {
+	logmerge(first, middle, last, std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+// MSD radix mode for integers, or for records with a key function returning an integer
+// whose order defines the sort.  Keys are mapped to unsigned so that negative ones come first
+
+template<class K>
+uint64_t log_radix_image(K k) {
+	static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value, "radix keys must be integers");
+	
+	return (uint64_t)(typename std::make_unsigned<K>::type)k ^
+	       (std::is_signed<K>::value ? (uint64_t)1 << (8*sizeof(K) - 1) : 0);
+}
+
+template<class T, class Key>
+struct log_radix_impl {
+	Key key;
+	
+	explicit log_radix_impl(Key k) : key(k) {}
+	
+	#define VAR T
+	#define CMP(a, b) (key(*(b)) < key(*(a)))
+	#define LOGSORT_RADIX(a) (log_radix_image(key(*(a))))
+	
+	#include "logsort.h"
+	
+	#undef VAR
+	#undef CMP
+	#undef LOGSORT_RADIX
+};
+
+template<class T, class Key>
+void logsort_radix(T *a, size_t n, size_t bLen, Key key) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	log_radix_impl<T, Key>(key).logsort_radix(a, n, bLen);
+}
+template<class T>
+struct log_radix_identity {
+	T operator()(const T &a) const { return a; }
+};
+template<class T>
+void logsort_radix(T *a, size_t n, size_t bLen = LOGSORT_AUTO) {
+	static_assert(std::is_integral<T>::value, "logsort_radix without a key function sorts integers");
+	
+	if(log_key_kind<T>::value) // vectorised partitions
+		logsort_impl<T, std::less<T> >(std::less<T>()).logsort_radix(a, n, bLen);
+	else
+		logsort_radix(a, n, bLen, log_radix_identity<T>());
+}
+template<class It, class Key>
+void logsort_radix(It first, It last, Key key) {
+	size_t n = last - first;
+	if(n) logsort_radix(&*first, n, LOGSORT_AUTO, key);
+}
+template<class It>
+void logsort_radix(It first, It last) {
+	size_t n = last - first;
+	if(n) logsort_radix(&*first, n);
+}
+
+// stable external sort of the T records of in to out, returns 0 or -1 on failure
+
+template<class T, class Compare>
+int logsort_file(FILE *in, FILE *out, size_t memBytes, size_t ioBytes, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	return logsort_impl<T, Compare>(comp).logsort_file(in, out, memBytes, ioBytes);
+}
+template<class T>
+int logsort_file(FILE *in, FILE *out, size_t memBytes, size_t ioBytes) {
+	return logsort_file<T>(in, out, memBytes, ioBytes, std::less<T>());
+}
+
+// columnar sorting: logsort_columns(n, std::make_tuple(k0, k1), std::make_tuple(p0, p1))
+// stably sorts the n rows of parallel arrays by the key columns k0, k1 with operator< in
+// order of significance and moves key and payload columns into the same order, without
+// packing rows.  It sorts (first key, row) tags, comparing the other key columns through
+// the row on ties, then moves each column in turn into the sorted order of the rows.
+// Returns -1 if the tags cannot be allocated, else 0
+
+// moves a[idx[i]] to a+i and leaves idx unchanged: gathered through buf if the column fits
+// there, else along the cycles of idx, marking visited indices in their top bit
+
+template<class T>
+void log_apply_column(T *a, size_t *idx, size_t n, void *buf, size_t bufBytes) {
+	const size_t visited = (size_t)1 << (sizeof(size_t)*8 - 1);
+	size_t i, j, k;
+	
+	if(std::is_trivially_copyable<T>::value && alignof(T) <= alignof(size_t) && n * sizeof(T) <= bufBytes) {
+		T *b = (T*)buf;
+		
+		for(i = 0; i < n; i++) b[i] = a[idx[i]];
+		std::copy(b, b+n, a);
+		return;
+	}
+	for(i = 0; i < n; i++) {
+		if(idx[i] & visited) continue;
+		
+		T t = std::move(a[i]); j = i;
+		
+		while((k = idx[j]) != i) {
+			a[j] = std::move(a[k]);
+			idx[j] |= visited; j = k;
+		}
+		a[j] = std::move(t);
+		idx[j] |= visited;
+	}
+	for(i = 0; i < n; i++) idx[i] &= ~visited;
+}
+
+template<size_t I, size_t N>
+struct log_columns {
+	template<class Tuple>
+	static bool less(const Tuple &k, size_t i, size_t j) {
+		const auto *c = std::get<I>(k);
+		
+		return c[i] < c[j] || (!(c[j] < c[i]) && log_columns<I+1, N>::less(k, i, j));
+	}
+	template<class Tuple>
+	static void apply(const Tuple &c, size_t *idx, size_t n, void *buf, size_t bufBytes) {
+		log_apply_column(std::get<I>(c), idx, n, buf, bufBytes);
+		log_columns<I+1, N>::apply(c, idx, n, buf, bufBytes);
+	}
+};
+template<size_t N>
+struct log_columns<N, N> {
+	template<class Tuple>
+	static bool less(const Tuple &, size_t, size_t) { return false; }
+	
+	template<class Tuple>
+	static void apply(const Tuple &, size_t *, size_t, void *, size_t) {}
+};
+
+template<class Keys, class K>
+struct log_columns_compare {
+	Keys keys;
+	
+	bool operator()(const log_tag<K> &x, const log_tag<K> &y) const {
+		return x.key < y.key || (!(y.key < x.key) && log_columns<1, std::tuple_size<Keys>::value>::less(keys, x.i, y.i));
+	}
+};
+
+template<class Keys, class Payload>
+int logsort_columns(size_t n, const Keys &keys, const Payload &payload) {
+	typedef typename std::decay<decltype(*std::get<0>(keys))>::type K;
+	log_tag<K> *t = (log_tag<K>*)malloc(n * sizeof(log_tag<K>));
+	
+	if(!t) return -1;
+	
+	const K *k = std::get<0>(keys);
+	for(size_t i = 0; i < n; i++) { t[i].key = k[i]; t[i].i = i; }
+	
+	log_columns_compare<Keys, K> cc = {keys};
+	logsort(t, n, LOGSORT_AUTO, cc);
+	
+	size_t *idx = (size_t*)(void*)t; // compact the indices into the tag array, the rest buffers columns
+	for(size_t i = 0; i < n; i++) memcpy(idx+i, &t[i].i, sizeof(size_t));
+	
+	size_t bufBytes = n * (sizeof(log_tag<K>) - sizeof(size_t));
+	
+	log_columns<0, std::tuple_size<Keys>::value>::apply(keys, idx, n, idx+n, bufBytes);
+	log_columns<0, std::tuple_size<Payload>::value>::apply(payload, idx, n, idx+n, bufBytes);
+	free(t);
+	
+	return 0;
+}
+template<class Keys>
+int logsort_columns(size_t n, const Keys &keys) {
+	return logsort_columns(n, keys, std::tuple<>());
+}
+
+// stable partition by a unary predicate with at most bLen elements of extra memory,
+// a low-memory std::stable_partition.  Only the partition functions are instantiated
+
+template<class T, class Pred>
+struct log_partition_impl {
+	Pred pred;
+	
+	explicit log_partition_impl(Pred p) : pred(p) {}
+	
+	#define VAR T
+	#define CMP(a, b) (0)
+	#define LOGSORT_PRED(a) (pred(*(a)))
+	
+	#include "logsort.h"
+	
+	#undef VAR
+	#undef CMP
+	#undef LOGSORT_PRED
+};
+
+template<class T, class Pred>
+T *log_stable_partition(T *a, size_t n, Pred pred, T *s, size_t bLen) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	return log_partition_impl<T, Pred>(pred).log_stable_partition(a, n, s, bLen);
+}
+template<class T, class Pred>
+T *log_stable_partition(T *a, size_t n, Pred pred, size_t bLen = LOGSORT_AUTO) {
+	if(bLen == LOGSORT_AUTO) bLen = log_auto_blen(sizeof(T), n);
+	
+	T *s = (T*)malloc(bLen * sizeof(T)), *p = log_stable_partition(a, n, pred, s, bLen);
+	free(s);
+	
+	return p;
+}
+template<class It, class Pred>
+It log_stable_partition(It first, It last, Pred pred) {
+	size_t n = last - first;
+	return n ? first + (log_stable_partition(&*first, n, pred) - &*first) : first;
+}
+
+template<class It, class Compare>
+void logsort(It first, It last, Compare comp) {
+	size_t n = last - first;
+	if(n) logsort(&*first, n, LOGSORT_AUTO, comp);
+}
+template<class It>
+void logsort(It first, It last) {
+	logsort(first, last, std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+#ifdef _OPENMP
+
+template<class T, class Compare>
+void logsort_parallel(T *a, size_t n, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_parallel(a, n, bLen);
+}
+template<class T>
+void logsort_parallel(T *a, size_t n, size_t bLen = LOGSORT_AUTO) {
+	logsort_parallel(a, n, bLen, std::less<T>());
+}
+
+template<class It, class Compare>
+void logsort_parallel(It first, It last, Compare comp) {
+	size_t n = last - first;
+	if(n) logsort_parallel(&*first, n, LOGSORT_AUTO, comp);
+}
+template<class It>
+void logsort_parallel(It first, It last) {
+	logsort_parallel(first, last, std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+template<class T, class Compare>
+void logsort_segmented_parallel(T *a, const size_t *off, size_t nseg, size_t bLen, Compare comp) {
+	static_assert(std::is_trivially_copyable<T>::value, "logsort moves elements with memcpy");
+	
+	logsort_impl<T, Compare>(comp).logsort_segmented_parallel(a, off, nseg, bLen);
+}
+template<class T>
+void logsort_segmented_parallel(T *a, const size_t *off, size_t nseg, size_t bLen = LOGSORT_AUTO) {
+	logsort_segmented_parallel(a, off, nseg, bLen, std::less<T>());
+}
+
+#endif
+
+#endif // LOGSORT_HPP
@@ -24,362 +24,684 @@ SOFTWARE.
  *
  */
 
+// benchmark harness: times sorts on element types, distributions and sizes given on the
+// command line and writes one CSV or JSON row per combination to stdout
+//
+//   gcc -O3 test.c -o test -lm
+//   ./test [-n sizes] [-t types] [-d dists] [-s sorts] [-r trials] [-w warmup] [-b bLen]
+//          [-p param] [-f csv|json]
+//
+// sizes:  comma separated N, 2^k or 2^a:b (every power of two from 2^a to 2^b)
+// types:  i32 i64 f32 f64 r16 r64 r256 (records with a 64-bit key and an index payload)
+// dists:  random unique few sqrt sorted reversed sawtooth organ nearly zipf
+//         (-p sets the unique values of few, the teeth of sawtooth, the percent of
+//         swapped elements of nearly and 100x the exponent of zipf)
+// sorts:  logsort logsort_inline logsort_radix qsort, std_sort std_stable_sort if built
+//         with -DUSE_STD_SORT and testStd.cpp, and the algos/ sorts on i32 if built with
+//         -DUSE_BLITSORT etc.
+//
+// logsort, qsort and the algos/ sorts call the same noinline cmp_* comparison functions.
+// logsort_inline inlines its comparisons and uses the vectorised kernels on primitive
+// keys, logsort_radix splits on key bits, and the std sorts inline a functor, so these
+// rows measure different comparison costs and are labelled apart.
+//
+// Built with -DLOGSORT_STATS, a cmp_per_elem column counts the comparisons of the logsort
+// sorts (0 for the others); add -DLOGSORT_MIN_CMP to compare the comparison-minimising mode.
+//
+// Every trial sorts the same inputs for all sorts, after warm-up runs which are not
+// timed.  The output is sorted and stable sorts are checked for stability on records.
+// The graphs/exp*.png plots compare sorts calling cmp_i32: the logsort, qsort and algos/
+// rows of the avg column of
+//
+//   ./test -n 2^14,2^20,2^24 -t i32 -d unique,sqrt,few -r 100 -b 512
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
-#include <sys/time.h>
 #include <time.h>
-#include <errno.h>
 #include <math.h>
-#include <assert.h>
-#include <stdbool.h>
 
 #define SEED 0
-#define LEN(A) (sizeof(A) / sizeof(*A))
-#define USE_AVG_TIME 1
 
-#define VAR_TYPE int
+#ifdef LOGSORT_STATS // count comparisons of the logsort instantiations
+	#define CMP_COLUMN 1
+#else
+	#define CMP_COLUMN 0
+#endif
+#define LEN(A) (sizeof(A) / sizeof(*A))
 
-long long utime()
-{
-	struct timeval now_time;
+long long ntime() {
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	
+	return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
 
-	gettimeofday(&now_time, NULL);
+uint64_t rng;
 
-	return now_time.tv_sec * 1000000LL + now_time.tv_usec;
+uint64_t rand64() { // xorshift64*
+	rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+	return rng * 2685821657736338717ULL;
 }
 
-// benching against qsort: no inline
+// element types: records sort by key and carry their input index for stability checks
+
+typedef struct { uint64_t key, idx; } rec16;
+typedef struct { uint64_t key, idx, pad[6]; } rec64;
+typedef struct { uint64_t key, idx, pad[30]; } rec256;
 
-__attribute__ ((noinline)) int cmp(const void * a, const void * b)
-{
-	const VAR_TYPE fa = *(const VAR_TYPE *) a;
-	const VAR_TYPE fb = *(const VAR_TYPE *) b;
+// benching against qsort: no inline
 
-	return fa - fb;
+#define PRIM_CMP(NAME, T) \
+__attribute__ ((noinline)) int NAME(const void *a, const void *b) { \
+	T x = *(const T*)a, y = *(const T*)b;                           \
+	return (x > y) - (x < y);                                       \
+}
+#define REC_CMP(NAME, T) \
+__attribute__ ((noinline)) int NAME(const void *a, const void *b) { \
+	uint64_t x = ((const T*)a)->key, y = ((const T*)b)->key;        \
+	return (x > y) - (x < y);                                       \
 }
 
-// import different sorts
+PRIM_CMP(cmp_i32, int32_t)
+PRIM_CMP(cmp_i64, int64_t)
+PRIM_CMP(cmp_f32, float)
+PRIM_CMP(cmp_f64, double)
+REC_CMP(cmp_r16,  rec16)
+REC_CMP(cmp_r64,  rec64)
+REC_CMP(cmp_r256, rec256)
 
-void qsortTest(VAR_TYPE *a, size_t n, size_t b) {
-	qsort(a, n, sizeof(*a), cmp);
-}
+// logsort instantiations: inlined comparisons with the vectorised kernels or radix keys
 
-void shellsort(VAR_TYPE *array, size_t N, size_t b) {
-	VAR_TYPE t;
-	size_t i, j, k;
-		
-	for(k = 730725073; k; k = k/4 - k/16) {
-		for(j = k; j < N; j++) {
-			t = array[j];
-			
-			for(i = j; i >= k && cmp(&array[i-k], &t) > 0; i -= k)
-				array[i] = array[i-k];
-			
-			array[i] = t;
-		}
-	}
-}
+#define LOGSORT_PREFIX i32
+#define VAR int32_t
+#define CMP(a, b) (*(a) > *(b))
+#define LOGSORT_KEY LOG_KEY_I32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef LOGSORT_KEY
 
+#define LOGSORT_PREFIX i64
+#define VAR int64_t
+#define LOGSORT_KEY LOG_KEY_I64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef LOGSORT_KEY
 
-#include "algos/blitsort.h"
-#include "algos/octosort.h"
+#define LOGSORT_PREFIX f32
+#define VAR float
+#define LOGSORT_KEY LOG_KEY_F32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef LOGSORT_KEY
 
-void octosortTest(VAR_TYPE *a, size_t n, size_t b) {
-	VAR_TYPE *s = malloc(b * sizeof(VAR_TYPE));
-	octosort32(a, n, s, b, cmp);
-	free(s);
-}
+#define LOGSORT_PREFIX f64
+#define VAR double
+#define LOGSORT_KEY LOG_KEY_F64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef LOGSORT_KEY
+#undef CMP
 
-void blitsortTest(VAR_TYPE *a, size_t n, size_t b) {
-	blitsort32(a, n, cmp);
-}
+#define CMP(a, b) ((a)->key > (b)->key)
+#define LOGSORT_RADIX(a) ((a)->key)
 
-void quadsortTest(VAR_TYPE *a, size_t n, size_t b) {
-	quadsort32(a, n, cmp);
-}
+#define LOGSORT_PREFIX r16
+#define VAR rec16
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
 
+#define LOGSORT_PREFIX r64
+#define VAR rec64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
 
-#define SORT_TYPE VAR_TYPE
-#define SORT_CMP cmp //(a,b) (*(a) - *(b))
+#define LOGSORT_PREFIX r256
+#define VAR rec256
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CMP
+#undef LOGSORT_RADIX
 
-#include "algos/GrailSort.h"
-#include "algos/SqrtSort.h"
+// and comparison-only ones calling the cmp_* functions like qsort
 
-#undef SORT_TYPE
-#undef SORT_CMP
+#define CMP(a, b) (CALLBACK_CMP((a), (b)))
 
-void grailsortTest(VAR_TYPE *a, size_t n, size_t b) {
-	VAR_TYPE *s = malloc(b * sizeof(VAR_TYPE));
-	grail_commonSort(a, n, s, b);
-	free(s);
-}
+#define LOGSORT_PREFIX cb_i32
+#define VAR int32_t
+#define CALLBACK_CMP cmp_i32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
 
-void sqrtsortTest(VAR_TYPE *a, size_t n, size_t b) {
-	SqrtSort(a, n);
-}
+#define LOGSORT_PREFIX cb_i64
+#define VAR int64_t
+#define CALLBACK_CMP cmp_i64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
 
+#define LOGSORT_PREFIX cb_f32
+#define VAR float
+#define CALLBACK_CMP cmp_f32
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
 
-#ifdef USE_SHELFSORT
+#define LOGSORT_PREFIX cb_f64
+#define VAR double
+#define CALLBACK_CMP cmp_f64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
+
+#define LOGSORT_PREFIX cb_r16
+#define VAR rec16
+#define CALLBACK_CMP cmp_r16
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
+
+#define LOGSORT_PREFIX cb_r64
+#define VAR rec64
+#define CALLBACK_CMP cmp_r64
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
+
+#define LOGSORT_PREFIX cb_r256
+#define VAR rec256
+#define CALLBACK_CMP cmp_r256
+#include "logsort.h"
+#undef LOGSORT_PREFIX
+#undef VAR
+#undef CALLBACK_CMP
+#undef CMP
 
+// per type: element access for generation and checking, and the sort wrappers
+
+typedef struct {
+	const char *name;
+	size_t size;
+	char record;
+	void (*set)(void *a, size_t i, uint64_t k);
+	uint64_t (*key)(const void *a, size_t i);
+	int (*cmp)(const void *a, const void *b);
+} type_info;
+
+#define TYPE_FUNCS(NAME, T, FROM, TO) \
+void set_##NAME(void *a, size_t i, uint64_t k) { FROM; }                   \
+uint64_t key_##NAME(const void *a, size_t i) { return TO; }                 \
+void logsort_##NAME(void *a, size_t n, size_t b) { cb_##NAME##_logsort((T*)a, n, b); } \
+void inline_##NAME(void *a, size_t n, size_t b) { NAME##_logsort((T*)a, n, b); } \
+void radix_##NAME(void *a, size_t n, size_t b) { NAME##_logsort_radix((T*)a, n, b); } \
+void qsort_##NAME(void *a, size_t n, size_t b) { (void)b; qsort(a, n, sizeof(T), cmp_##NAME); }
+
+#define REC_FROM(T) ((T*)a)[i].key = k; ((T*)a)[i].idx = i
+#define REC_TO(T)   ((const T*)a)[i].key
+
+TYPE_FUNCS(i32,  int32_t, ((int32_t*)a)[i] = (int32_t)k,          (uint64_t)((const int32_t*)a)[i])
+TYPE_FUNCS(i64,  int64_t, ((int64_t*)a)[i] = (int64_t)k,          (uint64_t)((const int64_t*)a)[i])
+TYPE_FUNCS(f32,  float,   ((float*)a)[i]   = (float)(int32_t)k,   (uint64_t)(int64_t)((const float*)a)[i])
+TYPE_FUNCS(f64,  double,  ((double*)a)[i]  = (double)(int64_t)k,  (uint64_t)(int64_t)((const double*)a)[i])
+TYPE_FUNCS(r16,  rec16,   REC_FROM(rec16),  REC_TO(rec16))
+TYPE_FUNCS(r64,  rec64,   REC_FROM(rec64),  REC_TO(rec64))
+TYPE_FUNCS(r256, rec256,  REC_FROM(rec256), REC_TO(rec256))
+
+type_info types[] = {
+	{"i32",  4,   0, set_i32,  key_i32,  cmp_i32},
+	{"i64",  8,   0, set_i64,  key_i64,  cmp_i64},
+	{"f32",  4,   0, set_f32,  key_f32,  cmp_f32},
+	{"f64",  8,   0, set_f64,  key_f64,  cmp_f64},
+	{"r16",  16,  1, set_r16,  key_r16,  cmp_r16},
+	{"r64",  64,  1, set_r64,  key_r64,  cmp_r64},
+	{"r256", 256, 1, set_r256, key_r256, cmp_r256},
+};
+
+#ifdef USE_STD_SORT
+	// testStd.cpp: g++ -O3 -c testStd.cpp && gcc -O3 -DUSE_STD_SORT test.c testStd.o -lstdc++ -lm
+	
+	#define STD_DECL(NAME) \
+	void std_sort_##NAME(void *a, size_t n, size_t b); \
+	void std_stable_sort_##NAME(void *a, size_t n, size_t b);
+	
+	STD_DECL(i32) STD_DECL(i64) STD_DECL(f32) STD_DECL(f64) STD_DECL(r16) STD_DECL(r64) STD_DECL(r256)
+#endif
+
+// the algos/ sorts sort 32-bit integers, with 512 elements of buffer for LOGSORT_AUTO
+
+#define VAR_TYPE int32_t
+#define cmp cmp_i32
+
+#ifdef USE_BLITSORT
+	#include "algos/blitsort.h"
+	
+	void blitsortTest(void *a, size_t n, size_t b) {
+		blitsort32(a, n, cmp);
+	}
+#endif
+
+#ifdef USE_OCTOSORT
+	#include "algos/octosort.h"
+	
+	void octosortTest(void *a, size_t n, size_t b) {
+		if(!b) b = 512;
+		VAR_TYPE *s = malloc(b * sizeof(VAR_TYPE));
+		if(!s) { fprintf(stderr, "out of memory: octosort buffer\n"); exit(1); }
+		octosort32(a, n, s, b, cmp);
+		free(s);
+	}
+#endif
+
+#if defined(USE_GRAILSORT) || defined(USE_SQRTSORT)
+	#define SORT_TYPE VAR_TYPE
+	#define SORT_CMP cmp
+	
+	#ifdef USE_GRAILSORT
+		#include "algos/GrailSort.h"
+		
+		void grailsortTest(void *a, size_t n, size_t b) {
+			if(!b) b = 512;
+			VAR_TYPE *s = malloc(b * sizeof(VAR_TYPE));
+			if(!s) { fprintf(stderr, "out of memory: grailsort buffer\n"); exit(1); }
+			grail_commonSort(a, n, s, b);
+			free(s);
+		}
+	#endif
+	#ifdef USE_SQRTSORT
+		#include "algos/SqrtSort.h"
+		
+		void sqrtsortTest(void *a, size_t n, size_t b) {
+			SqrtSort(a, n);
+		}
+	#endif
+	
+	#undef SORT_TYPE
+	#undef SORT_CMP
+#endif
+
+#ifdef USE_SHELFSORT
 	#define ELEMENT VAR_TYPE
 	#define CMP cmp
-
+	
 	#include "algos/shelfsort.h"
-
+	
 	#undef CMP
 	#undef ELEMENT
-
-	void shelfsortTest(VAR_TYPE *a, size_t n, size_t b) {
+	
+	void shelfsortTest(void *a, size_t n, size_t b) {
 		ShelfSort(a, n);
 	}
-	
 #endif
 
-
 #define VAR VAR_TYPE
-#define CMP cmp //(a,b) (*(a) - *(b))
+#define CMP cmp
 
 #ifdef USE_HELIUMSORT
-
 	#include "algos/heliumSort.h"
-
-	void heliumSortTest(VAR_TYPE *a, size_t n, size_t b) {
-		heliumSort(a, 0, n, b);
-	}
 	
+	void heliumSortTest(void *a, size_t n, size_t b) {
+		heliumSort(a, 0, n, b ? b : 512);
+	}
 #endif
 
 #ifdef USE_ECTASORT
-
 	#include "algos/ectasort.h"
 	
-	void ectasortTest(VAR_TYPE *a, size_t n, size_t b) {
+	void ectasortTest(void *a, size_t n, size_t b) {
 		ectasort(a, n);
 	}
-	
 #endif
 
-#include "logsort.h"
-
 #undef VAR
 #undef CMP
+#undef cmp
+
+// sorts: type is an index into types, stable sorts are checked for stability
+
+typedef struct {
+	const char *name;
+	int type;
+	char stable;
+	void (*sort)(void *a, size_t n, size_t b);
+} sort_info;
+
+#define SORTS(NAME, T) \
+	{"logsort", T, 1, logsort_##NAME}, \
+	{"logsort_inline", T, 1, inline_##NAME}, \
+	{"logsort_radix", T, 1, radix_##NAME}, \
+	{"qsort", T, 0, qsort_##NAME},
+#define STD_SORTS(NAME, T) \
+	{"std_sort", T, 0, std_sort_##NAME}, \
+	{"std_stable_sort", T, 1, std_stable_sort_##NAME},
+
+sort_info sorts[] = {
+	SORTS(i32, 0) SORTS(i64, 1) SORTS(f32, 2) SORTS(f64, 3) SORTS(r16, 4) SORTS(r64, 5) SORTS(r256, 6)
+#ifdef USE_STD_SORT
+	STD_SORTS(i32, 0) STD_SORTS(i64, 1) STD_SORTS(f32, 2) STD_SORTS(f64, 3)
+	STD_SORTS(r16, 4) STD_SORTS(r64, 5) STD_SORTS(r256, 6)
+#endif
+#ifdef USE_BLITSORT
+	{"blitsort", 0, 1, blitsortTest},
+#endif
+#ifdef USE_OCTOSORT
+	{"octosort", 0, 1, octosortTest},
+#endif
+#ifdef USE_GRAILSORT
+	{"grailsort", 0, 1, grailsortTest},
+#endif
+#ifdef USE_SQRTSORT
+	{"sqrtsort", 0, 1, sqrtsortTest},
+#endif
+#ifdef USE_SHELFSORT
+	{"shelfsort", 0, 1, shelfsortTest},
+#endif
+#ifdef USE_HELIUMSORT
+	{"heliumsort", 0, 1, heliumSortTest},
+#endif
+#ifdef USE_ECTASORT
+	{"ectasort", 0, 1, ectasortTest},
+#endif
+};
 
+// distributions: write n keys, p is the -p parameter or 0 for the default
 
-//array generation
-
-void randArray(VAR_TYPE *a, size_t n, size_t s) {
-	for(size_t i = 0; i < n; i++) {
-		size_t j = rand()%(i+1);
-		a[i] = a[j];
-		a[j] = (VAR_TYPE)(i >> s);
+void shuffle(uint64_t *k, size_t n) {
+	for(size_t i = n; i > 1; i--) {
+		size_t j = rand64() % i;
+		uint64_t t = k[i-1]; k[i-1] = k[j]; k[j] = t;
 	}
 }
-char verify(VAR_TYPE *a, size_t n, size_t s) {
-	for(size_t i = 0; i < n; i++)
-		if(a[i] != (i >> s)) return 0;
-	return 1;
-}
 
-void backwards(VAR_TYPE *a, size_t n, size_t s) {
-	for(size_t i = 0; i < n; i++) {
-		a[i] = (VAR_TYPE)((n-1 - i) >> s);
+void distRandom(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	for(size_t i = 0; i < n; i++) k[i] = rand64();
+}
+void distUnique(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	for(size_t i = 0; i < n; i++) k[i] = i;
+	shuffle(k, n);
+}
+void distFew(uint64_t *k, size_t n, size_t p) { // p unique values, 4 by default
+	if(!p) p = 4;
+	for(size_t i = 0; i < n; i++) k[i] = (uint64_t)i * p / n;
+	shuffle(k, n);
+}
+void distSqrt(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	distFew(k, n, (size_t)sqrt((double)n));
+}
+void distSorted(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	for(size_t i = 0; i < n; i++) k[i] = i;
+}
+void distReversed(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	for(size_t i = 0; i < n; i++) k[i] = n-1 - i;
+}
+void distSawtooth(uint64_t *k, size_t n, size_t p) { // p ascending teeth, 16 by default
+	size_t w = n / (p ? p : 16);
+	
+	if(!w) w = 1;
+	for(size_t i = 0; i < n; i++) k[i] = i % w;
+}
+void distOrgan(uint64_t *k, size_t n, size_t p) {
+	(void)p;
+	for(size_t i = 0; i < n; i++) k[i] = i < n/2 ? i : n-1 - i;
+}
+void distNearly(uint64_t *k, size_t n, size_t p) { // sorted with p% random swaps, 1 by default
+	size_t c = n * (p ? p : 1) / 100;
+	
+	distSorted(k, n, p);
+	
+	while(c--) {
+		size_t i = rand64() % n, j = rand64() % n;
+		uint64_t t = k[i]; k[i] = k[j]; k[j] = t;
 	}
 }
-
-//sort trial
-
-void sortTrial(long long *times, void (*sort)(VAR_TYPE*, size_t, size_t), VAR_TYPE *a, size_t n, size_t bLen, size_t sh, size_t trials, char prog) {
-	srand(SEED);
+void distZipf(uint64_t *k, size_t n, size_t p) { // exponent p/100 over n ranks, 1 by default
+	double s = p ? p / 100.0 : 1, *cdf = malloc(n * sizeof(double)), sum = 0;
 	
-	unsigned long long best = -1;
-	double avg = 0;
-	long long start, end, res;
+	if(!cdf) {
+		fprintf(stderr, "out of memory: zipf, N = %zu\n", n);
+		exit(1);
+	}
+	for(size_t i = 0; i < n; i++) cdf[i] = sum += pow((double)(i+1), -s);
 	
-	for(size_t i = 0; i < trials; i++) {
-		if(prog) {
-			printf("\r(%ld/%ld) ", i+1, trials);
-			fflush(stdout);
-		}
-		randArray(a, n, sh);
-		
-		start = utime();
-		
-		sort(a, n, bLen);
-		
-		end = utime();
-		res = end-start;
-		
-		assert(verify(a, n, sh));
+	for(size_t i = 0; i < n; i++) {
+		double u = (double)(rand64() >> 11) / 9007199254740992.0 * sum;
+		size_t lo = 0, hi = n-1;
 		
-		best = res < best ? res : best;
-		avg += res;
+		while(lo < hi) {
+			size_t m = lo + (hi-lo)/2;
+			if(cdf[m] < u) lo = m+1; else hi = m;
+		}
+		k[i] = lo;
 	}
-	if(prog) printf("\r");
-	
-	times[0] = best; 
-	times[1] = (long long)(avg / trials + 0.5);
+	free(cdf);
 }
 
-void sortTrials(long long *times, void (*sorts[])(VAR_TYPE*, size_t, size_t), char *sortNames[], size_t sortCount, void (*shuffle)(VAR_TYPE*, size_t, size_t),
-                VAR_TYPE *a, size_t n, size_t bLen, size_t sh, size_t trials) {
+typedef struct {
+	const char *name;
+	void (*gen)(uint64_t *k, size_t n, size_t p);
+} dist_info;
+
+dist_info dists[] = {
+	{"random", distRandom}, {"unique", distUnique}, {"few", distFew}, {"sqrt", distSqrt},
+	{"sorted", distSorted}, {"reversed", distReversed}, {"sawtooth", distSawtooth},
+	{"organ", distOrgan}, {"nearly", distNearly}, {"zipf", distZipf},
+};
+
+// checking: sorted, same keys as the input and, for stable sorts of records, equal keys in
+// input order
+
+char verify(type_info *t, sort_info *s, void *a, size_t n, uint64_t sum) {
+	char *p = a;
 	
-	printf("Sort,List Size,Data Type,Best Time (\u00B5s),Avg. Time (\u00B5s),Trials,Distribution\n");
+	for(size_t i = 0; i < n; i++) sum -= t->key(a, i);
+	if(sum) return 0;
 	
-	for(size_t i = 0; i < sortCount; i++) {
-		sortTrial(times, sorts[i], a, n, bLen, sh, trials, 1);
+	for(size_t i = 1; i < n; i++, p += t->size) {
+		int c = t->cmp(p, p + t->size);
 		
-		if(i > 0) //sometimes the times are biased for the first sort 
-			printf("%s,%ld,%ld bytes,%lld,%lld,%ld,%ld unique\n", sortNames[i], n, sizeof(VAR_TYPE), times[0], times[1], trials, n >> sh);
+		if(c > 0) return 0;
+		if(c == 0 && t->record && s->stable && ((uint64_t*)p)[1] > ((uint64_t*)(p + t->size))[1]) return 0;
 	}
-	printf("\n");
+	return 1;
 }
 
-void sortTrialsTest(long long *times, void (*sorts[])(VAR_TYPE*, size_t, size_t), char *sortNames[], size_t sortCount, void (*shuffle)(VAR_TYPE*, size_t, size_t),
-                    VAR_TYPE *a, size_t bLen, size_t sh, size_t trials) {
-	sortTrials(times, sorts, sortNames, sortCount, randArray, a, 1 << sh, bLen, sh-2, trials); // 4 unique
-	sortTrials(times, sorts, sortNames, sortCount, randArray, a, 1 << sh, bLen, sh/2, trials); // sqrt unique
-	sortTrials(times, sorts, sortNames, sortCount, randArray, a, 1 << sh, bLen, 0,    trials); // all unique
+// sort trial: warm-up runs, then trials timed on inputs seeded by their number
+
+int cmpTime(const void *a, const void *b) {
+	long long x = *(const long long*)a, y = *(const long long*)b;
+	return (x > y) - (x < y);
 }
 
-void sortTrialsS(long long *times, void (*sorts[])(VAR_TYPE*, size_t, size_t), char *sortNames[], size_t sortCount, void (*shuffle)(VAR_TYPE*, size_t, size_t),
-                VAR_TYPE *a, size_t n, size_t bLen, size_t *shifts, char *sNames[], size_t sCnt, size_t trials) {
-	
-	printf("Avg. Time (\u00B5s):");
-	for(size_t i = 1; i < sortCount; i++)
-		printf(",%s", sortNames[i]);
-	printf("\n");
+char sortTrial(double *stats, sort_info *s, dist_info *d, void *a, uint64_t *k, size_t n, size_t bLen, size_t p,
+               size_t warmup, size_t trials) {
+	type_info *t = types + s->type;
+	long long *times = malloc(trials * sizeof(long long)), start;
+	double avg = 0, var = 0, cmps = 0;
 	
-	for(size_t j = 0; j < sCnt; j++) {
-		printf("%s", sNames[j]);
-		size_t sh = shifts[j];
+	if(!times) {
+		fprintf(stderr, "out of memory: %zu trials\n", trials);
+		exit(1);
+	}
+	for(size_t i = 0; i < warmup + trials; i++) {
+		uint64_t sum = 0;
 		
-		for(size_t i = 0; i < sortCount; i++) {
-			sortTrial(times, sorts[i], a, n, bLen, sh, trials, 0);
-			
-			if(i > 0) { //sometimes the times are biased for the first sort 
-				printf(",%.6lf", (double) times[USE_AVG_TIME] / n);
-			}
+		rng = 0x9E3779B97F4A7C15ULL * (SEED + 1 + (i < warmup ? 0 : i - warmup + 1)); // nonzero
+		d->gen(k, n, p);
+		
+		for(size_t j = 0; j < n; j++) {
+			t->set(a, j, k[j]);
+			sum += t->key(a, j);
+		}
+#ifdef LOGSORT_STATS
+		log_stats_reset();
+#endif
+		start = ntime();
+		s->sort(a, n, bLen);
+		
+		if(i >= warmup) times[i - warmup] = ntime() - start;
+#ifdef LOGSORT_STATS
+		if(i >= warmup) cmps += log_stats_cmps();
+#endif
+		
+		if(!verify(t, s, a, n, sum)) {
+			free(times);
+			return 0;
 		}
-		printf("\n");
 	}
+	qsort(times, trials, sizeof(long long), cmpTime);
+	
+	for(size_t i = 0; i < trials; i++) avg += times[i];
+	avg /= trials;
+	for(size_t i = 0; i < trials; i++) var += (times[i] - avg) * (times[i] - avg);
+	
+	stats[0] = times[0] / 1e3;                                            // best (µs)
+	stats[1] = (trials % 2 ? times[trials/2] : (times[trials/2-1] + times[trials/2]) / 2.0) / 1e3; // median
+	stats[2] = avg / 1e3;                                                 // average
+	stats[3] = (trials > 1 ? sqrt(var / (trials-1)) : 0) / 1e3;           // sample deviation
+	stats[4] = cmps / trials / n;                                         // logsort comparisons per element
+	
+	free(times);
+	return 1;
 }
 
-void sortTrialsN(long long *times, void (*sorts[])(VAR_TYPE*, size_t, size_t), char *sortNames[], size_t sortCount, void (*shuffle)(VAR_TYPE*, size_t, size_t),
-                VAR_TYPE *a, size_t *nList, size_t nCnt, size_t *bList, size_t sh, size_t trials) {
+// command line
+
+char listed(const char *list, const char *name) { // name in a comma separated list
+	size_t len = strlen(name);
 	
-	printf("Avg.Time per Elem. (\u00B5s)");
-	for(size_t i = 1; i < sortCount; i++)
-		printf(",%s", sortNames[i]);
-	printf("\n");
+	for(const char *p = list; p; p = strchr(p, ',')) {
+		if(*p == ',') p++;
+		if(!strncmp(p, name, len) && (p[len] == ',' || !p[len])) return 1;
+	}
+	return 0;
+}
+
+size_t parseSizes(const char *arg, size_t *nList, size_t max) {
+	size_t c = 0;
 	
-	for(size_t j = 0; j < nCnt; j++) {
-		size_t n = nList[j];
-		printf("N = %ld", n); 
-		fflush(stdout);
+	for(const char *p = arg; p && *p && c < max; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+		char *e;
 		
-		for(size_t i = 0; i < sortCount; i++) {
-			sortTrial(times, sorts[i], a, n, bList[i], sh, trials, 0);
+		if(!strncmp(p, "2^", 2)) {
+			size_t a = strtoul(p+2, &e, 10), b = a;
 			
-			if(i > 0) { //sometimes the times are biased for the first sort 
-				printf(",%.6lf", (double) times[USE_AVG_TIME] / n);
-				fflush(stdout);
-			}
+			if(*e == ':') b = strtoul(e+1, &e, 10);
+			for(; a <= b && c < max; a++) nList[c++] = (size_t)1 << a;
 		}
-		printf("\n");
+		else nList[c++] = (size_t)strtod(p, &e);
 	}
+	return c;
 }
 
-//printing array / debugging
-
-void printA(VAR_TYPE *data_arr, size_t data_length) {
-    while(data_length--) {
-        printf("%lld,", (long long) *data_arr);
-        *data_arr++;
-    }
-    printf("\n");
+void usage() {
+	fprintf(stderr, "usage: test [-n sizes] [-t types] [-d dists] [-s sorts] [-r trials] [-w warmup]\n"
+	                "            [-b bLen] [-p param] [-f csv|json]\n");
+	exit(1);
 }
 
-void printABars(VAR_TYPE *a, size_t n) {
-	VAR_TYPE *max = a, *pa = a+1;
+int main(int argc, char **argv) {
+	const char *typeList = "i32", *distList = "random,unique,few,sqrt", *sortList = NULL, *format = "csv";
+	size_t nList[64], nCnt = 0, trials = 10, warmup = 1, bLen = LOGSORT_AUTO, p = 0, rows = 0;
 	
-	for(size_t i = n-1; i; i--) {
-		if(cmp(pa, max) > 0) {
-			max = pa;
-		}
-		pa++;
-	}
-	for(VAR_TYPE i = *max; i+1; i--) {
-		for(size_t j = 0; j < n; j++) {
-			if(cmp(a+j, &i) >= 0) 
-				printf("##");
-			else
-				printf(". ");
+	for(int i = 1; i < argc; i++) {
+		if(argv[i][0] != '-' || !argv[i][1] || argv[i][2] || i+1 == argc) usage();
+		
+		const char *v = argv[++i];
+		
+		switch(argv[i-1][1]) {
+			case 'n': nCnt = parseSizes(v, nList, LEN(nList)); break;
+			case 't': typeList = v; break;
+			case 'd': distList = v; break;
+			case 's': sortList = v; break;
+			case 'r': trials = strtoul(v, NULL, 10); break;
+			case 'w': warmup = strtoul(v, NULL, 10); break;
+			case 'b': bLen = strtoul(v, NULL, 10); break;
+			case 'p': p = strtoul(v, NULL, 10); break;
+			case 'f': format = v; break;
+			default: usage();
 		}
-		printf("\n");
 	}
-}
-
-int main() {
-	size_t n = 1 << 24, b = 512;
-	VAR_TYPE *a = (VAR_TYPE*) malloc(n * sizeof(VAR_TYPE));
-	
-	/*void (*sorts[])(VAR_TYPE*, size_t, size_t) = { logsort, 
-		blitsortTest, 
-		ectasortTest,
-		shelfsortTest, 
-		sqrtsortTest, 
-		octosortTest, 
-		heliumSortTest, 
-		grailsortTest, 
-		qsortTest, 
-		logsort
-	};
-	char *sortNames[] = { "", 
-		"Blitsort (512)", 
-		"Ectasort (\u221AN)",
-		"Shelfsort (\u221AN)",
-		"Sqrtsort (\u221AN)", 
-		"Octosort (512)", 
-		"Helium Sort (512)", 
-		"Grailsort (512)", 
-		"qsort", 
-		"Logsort (512)"
-	};*/
+	if(!nCnt) nCnt = parseSizes("2^14,2^20", nList, LEN(nList));
+	if(!trials) trials = 1;
 	
-	void (*sorts[])(VAR_TYPE*, size_t, size_t) = { logsort, 
-		blitsortTest,
-		sqrtsortTest, 
-		octosortTest, 
-		grailsortTest, 
-		logsort
-	};
-	char *sortNames[] = { "", 
-		"Blitsort (512)",
-		"Sqrtsort (\u221AN)", 
-		"Octosort (512)", 
-		"Grailsort (512)", 
-		"Logsort (512)"
-	};
+	char json = !strcmp(format, "json");
 	
-	size_t trials = 100;
-	size_t sortCount = LEN(sorts);
-	long long times[2];
+	if(json) printf("[\n");
+	else printf("sort,type,bytes,dist,param,n,blen,trials,best_us,median_us,avg_us,stddev_us,ns_per_elem%s\n",
+	            CMP_COLUMN ? ",cmp_per_elem" : "");
 	
-	/*const size_t exp = 7;
-	size_t bList[] = {512, 512, 512, 512, 512, 512, 512, 512, 512, 512, 512, 512};
-	size_t nList[] = {1<<14, 1<<16, 1<<18, 1<<20, 1<<22, 1<<24};
-	size_t nCnt = LEN(nList);
-	
-	sortTrialsN(times, sorts, sortNames, sortCount, randArray, a, nList, nCnt, bList, 0, 100);*/
-	
-	printf("using buffer size %ld\n\n", b);
-	
-	sortTrialsTest(times, sorts, sortNames, sortCount, randArray, a, b, 14, trials);
-	sortTrialsTest(times, sorts, sortNames, sortCount, randArray, a, b, 20, trials);
-	sortTrialsTest(times, sorts, sortNames, sortCount, randArray, a, b, 24, trials);
-	
-	free(a);
+	for(size_t ni = 0; ni < nCnt; ni++) {
+		size_t n = nList[ni];
+		
+		for(size_t ti = 0; ti < LEN(types); ti++) {
+			if(!listed(typeList, types[ti].name)) continue;
+			
+			char fits = n <= SIZE_MAX / types[ti].size; // n * size must not wrap
+			void *a = fits ? malloc(n * types[ti].size) : NULL;
+			uint64_t *k = fits ? malloc(n * sizeof(uint64_t)) : NULL;
+			
+			if(!a || !k) {
+				fprintf(stderr, "out of memory: %s, N = %zu\n", types[ti].name, n);
+				free(a); free(k);
+				continue;
+			}
+			for(size_t di = 0; di < LEN(dists); di++) {
+				if(!listed(distList, dists[di].name)) continue;
+				
+				for(size_t si = 0; si < LEN(sorts); si++) {
+					sort_info *s = sorts + si;
+					double st[5];
+					
+					if(s->type != (int)ti || (sortList && !listed(sortList, s->name))) continue;
+					
+					fprintf(stderr, "%s %s %s N = %zu\n", s->name, types[ti].name, dists[di].name, n);
+					
+					if(!sortTrial(st, s, dists + di, a, k, n, bLen, p, warmup, trials)) {
+						fprintf(stderr, "%s failed on %s %s N = %zu\n", s->name, types[ti].name, dists[di].name, n);
+						return 1;
+					}
+					if(json)
+						printf("%s  {\"sort\": \"%s\", \"type\": \"%s\", \"bytes\": %zu, \"dist\": \"%s\", \"param\": %zu, "
+						       "\"n\": %zu, \"blen\": %zu, \"trials\": %zu, \"best_us\": %.3f, \"median_us\": %.3f, "
+						       "\"avg_us\": %.3f, \"stddev_us\": %.3f, \"ns_per_elem\": %.4f",
+						       rows ? ",\n" : "", s->name, types[ti].name, types[ti].size, dists[di].name, p,
+						       n, bLen, trials, st[0], st[1], st[2], st[3], st[2] * 1e3 / n);
+					else
+						printf("%s,%s,%zu,%s,%zu,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.4f",
+						       s->name, types[ti].name, types[ti].size, dists[di].name, p,
+						       n, bLen, trials, st[0], st[1], st[2], st[3], st[2] * 1e3 / n);
+					
+					if(CMP_COLUMN) printf(json ? ", \"cmp_per_elem\": %.3f" : ",%.3f", st[4]);
+					printf(json ? "}" : "\n");
+					fflush(stdout);
+					rows++;
+				}
+			}
+			free(a);
+			free(k);
+		}
+	}
+	if(json) printf("\n]\n");
 	
 	return 0;
 }
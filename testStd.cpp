@@ -0,0 +1,53 @@
+/*
+ * 
+MIT License
+
+Copyright (c) 2022-2024 aphitorite
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ *
+ */
+
+// std::sort and std::stable_sort for test.c built with -DUSE_STD_SORT, on the same
+// element types: records of W 64-bit words sorted by the first
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+
+template<size_t W>
+struct rec { uint64_t key, rest[W-1]; };
+
+template<class T>
+struct by_key { bool operator()(const T &a, const T &b) const { return a.key < b.key; } };
+
+template<class T>
+struct by_value { bool operator()(const T &a, const T &b) const { return a < b; } };
+
+#define STD_DEF(NAME, T, LESS) \
+extern "C" void std_sort_##NAME(void *a, size_t n, size_t) { std::sort((T*)a, (T*)a + n, LESS()); } \
+extern "C" void std_stable_sort_##NAME(void *a, size_t n, size_t) { std::stable_sort((T*)a, (T*)a + n, LESS()); }
+
+STD_DEF(i32,  int32_t,  by_value<int32_t>)
+STD_DEF(i64,  int64_t,  by_value<int64_t>)
+STD_DEF(f32,  float,    by_value<float>)
+STD_DEF(f64,  double,   by_value<double>)
+STD_DEF(r16,  rec<2>,   by_key<rec<2> >)
+STD_DEF(r64,  rec<8>,   by_key<rec<8> >)
+STD_DEF(r256, rec<32>,  by_key<rec<32> >)